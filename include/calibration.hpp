@@ -1,24 +1,56 @@
 #ifndef CALIBRATION_H
 #define CALIBRATION_H
 #include <atomic>
-#include "encoder.hpp"
+#include "profile.hpp"
+#include "nvs.h"
+#include "defines.h"
 
 class Calibration {
   public:
+    explicit Calibration(const char* nvsNs) : nvsNamespace(nvsNs) {}
     void init();
-    bool beginDownwardCalib(Encoder& topEnc);
-    bool completeCalib(Encoder& topEnc);
-    int32_t convertToTicks(uint8_t appPos);
-    uint8_t convertToAppPos(int32_t ticks);
+    // count: motor encoder count at the end of travel
+    bool beginDownwardCalib(int32_t count);
+    bool completeCalib(int32_t count);
+    int32_t convertToTicks(uint16_t appPos);
+    uint16_t convertToAppPos(int32_t ticks);
     bool getCalibrated() {return calibrated;}
     bool clearCalibrated();
+    bool saveGains(const PIDGains& newGains);
+    bool saveCoast();
+    bool saveCurve(const uint16_t* knots);
+    // Knots from the server, range-checked before narrowing; false if not a valid curve
+    static bool curveFromKnots(const int32_t* values, uint16_t* knots);
+    bool saveLash();
     std::atomic<int32_t> DownTicks;
     std::atomic<int32_t> UpTicks;
+    PIDGains gains; // speed loop gains, persisted with the calibration
+    // Learned coast after a power cut, in ticks per tick/s of speed at the cut
+    float coastUp;
+    float coastDown;
+    // Backlash: how far the motor leads the slats while driving up / down, ticks
+    float lashUp;
+    float lashDown;
 
   private:
+    const char* nvsNamespace; // one namespace per port
+    void loadTuning(nvs_handle_t calibHandle);
+    void buildMap();
+    bool storeTuning(nvs_handle_t calibHandle);
+    float savedCoastUp;
+    float savedCoastDown;
+    float savedLashUp;
+    float savedLashDown;
     std::atomic<bool> calibrated;
-};
 
-extern Calibration calib;
+    // Position curve: travel in per-mille of the range at each knot, monotone
+    uint16_t curve[curveKnots];
+    // Precomputed from curve and range. Offsets run from DownTicks toward UpTicks.
+    int8_t rangeDir;                      // sign of UpTicks - DownTicks
+    int32_t knotOffset[curveKnots];       // ticks from DownTicks
+    uint32_t spanRecip[curveKnots - 1];   // 2^32 / segment ticks, 0 for empty segments
+    uint64_t appToKnot;                   // 2^32 * (curveKnots - 1) / posResolution
+    uint32_t knotToApp;                   // 2^16 * posResolution / (curveKnots - 1)
+};
 
 #endif
\ No newline at end of file
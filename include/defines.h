@@ -10,6 +10,11 @@
 #define ccwMax 10
 #define cwMax 0
 
+// App position scale (0..posResolution) and the curve mapping it onto the
+// calibrated range. The server currently sends 0-10.
+#define posResolution 10
+#define curveKnots 11 // evenly spaced in app position, per-mille of travel
+
 #define nvsWiFi "WiFiCreds"
 #define ssidTag "SSID"
 #define passTag "PW"
@@ -23,13 +28,31 @@
 #define UpTicksTag "UP"
 #define DownTicksTag "DOWN"
 #define statusTag "STATUS"
+#define kpTag "KP" // PID gains stored x1000
+#define kiTag "KI"
+#define kdTag "KD"
+#define kfTag "KF"
+#define coastUpTag "COASTUP" // coast model stored x1000
+#define coastDownTag "COASTDN"
+#define curveTag "CURVE" // position curve knots, blob of uint16 per-mille
+#define lashUpTag "LASHUP" // backlash model stored x1000
+#define lashDownTag "LASHDN"
 
 #define nvsServo "SERVO"
 #define posTag "POS"
 
+// Position journal partition (partitions.csv) and write coalescing
+#define posJournalLabel "posjrnl"
+#define posJournalSubtype 0x40
+#define journalSettleMs 2000 // position must hold this long before it is written
+
 #define secureSrv true
 // #define srvAddr "192.168.1.190:3000"
 #define srvAddr "wahwa.com"
+#define sioTxFrameSize 256 // longest outbound Socket.IO event
+#define sioMaxTokens 128 // JSON tokens in one inbound event
+#define sioQueueLen 12 // events kept while offline, state events newest per event and port
+#define sioQueueMaxAgeMs 600000 // older offline events are dropped instead of replayed
 
 #define ENCODER_PIN_A GPIO_NUM_23 // d5
 #define ENCODER_PIN_B GPIO_NUM_16 // d6
@@ -41,6 +64,75 @@
 #define servoLEDCChannel LEDC_CHANNEL_0
 #define servoSwitch GPIO_NUM_17
 
+// Blinds driven by this device. Each port gets its own encoders, LEDC
+// channel, servo pins and NVS namespaces; wiring lives in main.cpp.
+#define NUM_PORTS 1
+
 #define debugLED GPIO_NUM_22 // d4
 
+#define motionTaskPriority 20 // high, but below esp_timer (22) and WiFi (23)
+#define motionTaskStack 4096
+#define portTaskPriority 5 // saves and reports positions, online or not
+#define portTaskStack 4096
+#define portTaskPeriodMs 100
+#define isrProfiling true // track worst-case encoder ISR duration
+#define motionPollMs 100 // sampling period for watch-point encoder backends
+#define motionQueueLen 8 // pending move/cancel/calibrate commands
+#define motionResultLen 8 // calibration results waiting for the port task to send
+#define calibSettleMs 1000 // servo settle time before a calibration stage is recorded
+
+// Count the motor encoder on the PCNT peripheral instead of per-edge GPIO interrupts
+#define topEncPCNT false
+#define pcntGlitchNs 1000 // PCNT input glitch filter width
+
+// LEDC hardware fade ramps for manual runs and stops
+#define rampStartMs 80 // offSpeed to full speed
+#define rampStopMs 60 // any speed to offSpeed; servo power is cut afterwards
+
+// Server move speed profile (ticks, ticks/s, ticks/s^2)
+#define controlPeriodMs 20 // one 50 Hz servo frame
+#define profileMaxVel 40.0f
+#define profileAccel 120.0f
+#define profileTolerance 1
+#define profileSettleVel 2.0f
+#define defaultKp 8.0f
+#define defaultKi 20.0f
+#define defaultKd 0.0f
+#define defaultKf 35.0f
+
+// Wand follow: drive proportional to the wand-motor error, with the wand's
+// speed fed forward through the speed loop's kf
+#define followKp 300.0f // duty per tick of error
+#define followMinDuty 250 // least drive that still turns the servo
+#define followDeadband 1 // ticks of error left unanswered
+#define followHoldVel 2 // wand ticks/s that keeps a running motor going inside the deadband
+
+// Learned coast-distance stopping (s = ticks per tick/s)
+#define defaultCoast 0.05f
+#define coastLearnRate 0.25f
+#define coastSettleMs 300 // no detents for this long = motor has stopped
+#define coastSaveChange 0.1f // rewrite NVS once the model drifts 10%
+
+// Backlash: motor lead over the slats while driving up (count rising) or down.
+// Learned from wand corrections shortly after a move that reversed direction.
+#define defaultLash 0.0f
+#define lashLearnRate 0.5f
+#define lashLearnMs 10000 // a wand correction this soon after a reversed move is a lash sample
+#define lashMaxTicks 8.0f
+#define lashSaveChange 0.5f // ticks
+
+// Stall detection from the motor encoder's last detent timestamp
+#define stallEdgePeriods 3 // missed detent periods at the expected speed before a stall
+#define stallMinMs 150 // floor, covers PCNT poll latency
+#define stallMaxMs 500 // ceiling, also the spin-up allowance before the first detent
+#define idleSaveMs 500 // save the position once the motor has been still this long
+
+// Automatic end-stop calibration sweep
+#define autoCalibDuty 600 // reduced drive, duty offset from offSpeed
+#define autoCalibSpinUpMs 500 // ignore low speed while the motor gets going
+#define autoCalibCollapse 0.3f // end stop = speed below this fraction of the sweep's peak
+#define autoCalibMargin 2 // ticks to back off from each end stop
+#define autoCalibTimeoutMs 30000 // per sweep
+#define kfTuneRange 4.0f // a kf measured by the sweep is kept within this factor of defaultKf
+
 #endif
\ No newline at end of file
@@ -3,41 +3,169 @@
 #include "driver/gpio.h"
 #include <atomic>
 #include "esp_timer.h"
+#include "esp_attr.h"
+#include "motion.hpp"
+#include "quadrature.hpp"
+#include "defines.h"
 
+#define MAX_ENCODERS (2 * NUM_PORTS)
+#define EDGE_HISTORY 16 // timestamped detents kept per encoder, power of two
+
+struct EdgeSample {
+  int32_t count;
+  uint32_t timeUs; // low 32 bits of esp_timer_get_time()
+};
+
+class BlindPort;
+
+// Common encoder state plus the abstract counting backend interface.
+// Backends report detents to the motion task via motionPostFromISR().
 class Encoder {
 public:
-  // Shared between ISR and main code
-  std::atomic<int32_t> count;
-  
-  // ISR-only state
-  uint8_t last_state_a;
-  uint8_t last_state_b;
-  int8_t last_count_base;
-  
+  // Illegal double transitions seen by the decoder (both pins changed between reads)
+  std::atomic<uint32_t> errors;
+
   // Configuration
   gpio_num_t pin_a;
   gpio_num_t pin_b;
-  
-  // Static ISR that receives instance pointer via arg
-  static void isr_handler(void* arg);
+  uint8_t id; // index into the encoder registry, carried in motion events
+
+  static Encoder* fromId(uint8_t id) { return id < MAX_ENCODERS ? registry[id] : nullptr; }
+
+  // Worst-case encoder ISR duration in CPU cycles (isrProfiling)
+  static std::atomic<uint32_t> isrMaxCycles;
 
-  std::atomic<bool> feedWDog;
   std::atomic<bool> serverListen;
   std::atomic<bool> wandListen;
 
-  esp_timer_handle_t watchdog_handle;
-  
+  BlindPort* port; // owning port, motion events are routed to it
+
   // Constructor and methods
   Encoder(gpio_num_t pinA, gpio_num_t pinB);
-  void init();
-  int32_t getCount() const { return count; }
-  void setCount(int32_t value) { count = value; }
-  void deinit();
+  uint32_t getErrors() const { return errors; }
+
+  // Counting backend interface
+  virtual void init() = 0;
+  virtual void deinit() = 0;
+  virtual int32_t getCount() const = 0;
+  virtual void setCount(int32_t value) = 0;
+  // Ask for a motion event when the count reaches value. Backends that
+  // already report every detent ignore this. Task context only.
+  virtual void setWatch(int32_t value) {}
+  // Low-rate sampling for backends that don't report every detent.
+  // Returns true with the new count if it changed since the last poll.
+  virtual bool poll(int32_t& value) { return false; }
+
+  // Detent history and filtered speed estimate, fed by the motion task.
+  // Velocity is in milli-ticks/s.
+  void recordEdge(int32_t count, uint32_t timeUs);
+  int32_t getVelocity() const;
+  uint32_t getLastEdgeUs() const { return lastEdgeUs; }
+  uint8_t getEdges(EdgeSample* out, uint8_t max) const; // newest first
+
+  virtual ~Encoder() {}
+
+protected:
+  bool registerInstance();
+
+private:
+  static Encoder* registry[MAX_ENCODERS];
+  static uint8_t registered;
+
+  EdgeSample edges[EDGE_HISTORY];
+  std::atomic<uint32_t> edgeHead;
+  std::atomic<int32_t> velocity;
+  std::atomic<uint32_t> lastEdgeUs;
+};
 
-  void setupWatchdog();
-  void pauseWatchdog();
+// Per-edge GPIO interrupt quadrature decoder. All instances share one
+// bank ISR that decodes every encoder from a single GPIO.in snapshot;
+// each pin layout brings its own decoder with constant masks.
+class GpioEncoder : public Encoder {
+public:
+  void init() override;
+  void deinit() override;
+  int32_t getCount() const override { return count; }
+  void setCount(int32_t value) override { count = value; }
+
+  // Raw GPIO interrupt handler for the whole encoder bank
+  static void bank_isr(void* arg);
+
+  // Decode one GPIO.in snapshot for a bank: only encoders whose pins
+  // changed since prevLevels are run. Called by bank_isr, and by host
+  // tests with a recorded trace.
+  static inline __attribute__((always_inline)) void decodeBank(GpioEncoder* const* encoders, uint8_t size,
+                                                               uint32_t pinMask, uint32_t prevLevels, uint32_t levels) {
+    uint32_t edges = (levels ^ prevLevels) & pinMask;
+    for (uint8_t i = 0; edges && i < size; i++) {
+      GpioEncoder* encoder = encoders[i];
+      if (edges & encoder->pin_mask) {
+        encoder->decodeFn(encoder, prevLevels, levels);
+        edges &= ~encoder->pin_mask;
+      }
+    }
+  }
+
+protected:
+  // Decodes one encoder from the previous and current snapshot words
+  typedef void (*DecodeFn)(GpioEncoder* encoder, uint32_t prevLevels, uint32_t levels);
+
+  GpioEncoder(gpio_num_t pinA, gpio_num_t pinB, gpio_pull_mode_t pull, DecodeFn decode);
+
+  // Apply one transition, indexed (prev AB << 2) | current AB, and post
+  // a motion event each time Divisor quarter steps make a whole detent.
+  template <uint8_t Divisor>
+  inline __attribute__((always_inline)) void step(uint8_t transition) {
+    int8_t quarter = quadTable[transition];
+    if (quarter == QUAD_ERR) {
+      errors.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    last_count_base += quarter;
+
+    // Accumulate to full detent count
+    int8_t detent = 0;
+    if (last_count_base >= Divisor) {
+      detent = 1;
+      last_count_base -= Divisor;
+    }
+    else if (last_count_base < 0) {
+      detent = -1;
+      last_count_base += Divisor;
+    }
+
+    // Listeners, stall supervision and LED run in the motion task, not here
+    if (detent) motionPostFromISR(id, count.fetch_add(detent) + detent);
+  }
+
+private:
+  // Shared between ISR and main code
+  std::atomic<int32_t> count;
+
+  // Configuration
+  uint32_t pin_mask; // (1 << pin_a) | (1 << pin_b)
+  gpio_pull_mode_t pull;
+  DecodeFn decodeFn;
+
+  // ISR-only state
+  int8_t last_count_base;
+};
+
+// GPIO encoder on fixed pins. Pins, pull mode and quarter steps per detent
+// are template parameters, so the decoder's shifts and masks are constants.
+template <gpio_num_t PinA, gpio_num_t PinB, gpio_pull_mode_t Pull = GPIO_PULLUP_ONLY, uint8_t Divisor = 4>
+class PinnedEncoder : public GpioEncoder {
+  static_assert(PinA != PinB && PinA < 32 && PinB < 32, "encoder pins must be two distinct GPIOs in GPIO.in");
+  static_assert(Divisor > 0 && Divisor <= 64, "detent divisor out of range");
+public:
+  PinnedEncoder() : GpioEncoder(PinA, PinB, Pull, &decode) {}
 
-  ~Encoder();
+private:
+  static IRAM_ATTR void decode(GpioEncoder* encoder, uint32_t prevLevels, uint32_t levels) {
+    uint32_t prev = (((prevLevels >> PinA) & 0x1) << 1) | ((prevLevels >> PinB) & 0x1);
+    uint32_t current = (((levels >> PinA) & 0x1) << 1) | ((levels >> PinB) & 0x1);
+    static_cast<PinnedEncoder*>(encoder)->template step<Divisor>((prev << 2) | current);
+  }
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,34 @@
+#ifndef EVENTWRITER_H
+#define EVENTWRITER_H
+#include <stddef.h>
+#include <stdint.h>
+
+// Formats one outbound Socket.IO event frame, 42["name",{"key":value,...}],
+// into a caller-supplied buffer without touching the heap. The JSON part is
+// byte-for-byte what cJSON_PrintUnformatted gives for the same tree.
+class EventWriter {
+  public:
+    EventWriter(char* buffer, size_t size, const char* event);
+    EventWriter& addNumber(const char* key, int32_t value);
+    EventWriter& addBool(const char* key, bool value);
+    EventWriter& addString(const char* key, const char* value);
+
+    // Close the frame. Returns its length, or 0 if it didn't fit.
+    size_t finish();
+    const char* frame() const { return buf; }
+    const char* json() const { return buf + 2; } // event array without the packet type prefix
+
+  private:
+    void put(char c);
+    void putRaw(const char* s);
+    void putQuoted(const char* s);
+    void putKey(const char* key);
+
+    char* buf;
+    size_t size;
+    size_t len;
+    bool firstField;
+    bool overflow;
+};
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef JSONTOKENS_H
+#define JSONTOKENS_H
+#include <stddef.h>
+#include <stdint.h>
+
+// In-place JSON tokenizer in the style of jsmn: one pass over the text fills
+// a caller-supplied token array with offsets into it, nothing is copied or
+// allocated. Strings are left escaped.
+enum JsonType : uint8_t {
+  JSON_UNDEFINED,
+  JSON_OBJECT,
+  JSON_ARRAY,
+  JSON_STRING,
+  JSON_PRIMITIVE, // number, true, false or null
+};
+
+struct JsonToken {
+  JsonType type;
+  uint16_t start;  // offset of the first character (inside the quotes for strings)
+  uint16_t end;    // offset one past the last character
+  uint16_t size;   // members of an object, items of an array, 1 for a key
+  int16_t parent;
+};
+
+#define JSON_ERROR_NOMEM -1 // more tokens than the array holds
+#define JSON_ERROR_INVAL -2 // malformed text
+#define JSON_ERROR_PART -3  // text ends inside a value
+
+// Returns the number of tokens used, or a JSON_ERROR_* code
+int jsonTokenize(const char* js, size_t len, JsonToken* tokens, uint16_t maxTokens);
+
+// Read-only view over tokenized text. Token indices are ints; -1 means missing.
+struct JsonDoc {
+  const char* js;
+  const JsonToken* tokens;
+  int count;
+
+  int next(int i) const;                       // first token after i and everything inside it
+  int get(int object, const char* key) const;  // value of key in an object
+  int item(int array, int n) const;            // nth item of an array
+  bool isObject(int i) const { return valid(i) && tokens[i].type == JSON_OBJECT; }
+  bool isArray(int i) const { return valid(i) && tokens[i].type == JSON_ARRAY; }
+  bool isString(int i) const { return valid(i) && tokens[i].type == JSON_STRING; }
+  bool equals(int i, const char* s) const;     // string token equals s (no unescaping)
+  bool getInt(int i, int32_t& value) const;    // number token, fraction truncated
+  int size(int i) const { return valid(i) ? tokens[i].size : 0; }
+  int length(int i) const { return valid(i) ? tokens[i].end - tokens[i].start : 0; }
+  const char* text(int i) const { return valid(i) ? js + tokens[i].start : ""; }
+
+  bool valid(int i) const { return i >= 0 && i < count; }
+};
+
+#endif
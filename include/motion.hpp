@@ -0,0 +1,156 @@
+#ifndef MOTION_H
+#define MOTION_H
+#include <atomic>
+#include <string.h>
+#include <type_traits>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "esp_attr.h"
+#include "defines.h"
+
+// Compact detent record produced by the encoder ISR
+struct EncoderEvent {
+  uint8_t id;       // Encoder::id of the encoder that moved
+  int32_t count;    // encoder count after this detent
+  uint32_t timeUs;  // low 32 bits of esp_timer_get_time()
+};
+
+// Requests handled by the motion task, which owns the servo and encoders.
+// Producers (Socket.IO, setup) enqueue and return immediately.
+enum MotionCommandType : uint8_t {
+  MOTION_MOVE,         // value = app position
+  MOTION_CANCEL,       // stop any move or calibration in progress
+  MOTION_CALIB_START,
+  MOTION_CALIB_STAGE1, // user finished tilting up
+  MOTION_CALIB_STAGE2, // user finished tilting down
+  MOTION_CALIB_AUTO,   // find both end stops without the user
+  MOTION_CURVE,        // knots = new position curve
+};
+
+struct MotionCommand {
+  MotionCommandType type;
+  uint8_t port;
+  union {
+    int32_t value;
+    uint16_t knots[curveKnots]; // per-mille of travel at each knot
+  };
+};
+
+// Outcomes the server must hear about. The motion task never waits on the
+// network: it queues these and the port task sends them.
+enum MotionResultType : uint8_t {
+  RESULT_CALIB_STAGE1_READY,
+  RESULT_CALIB_STAGE2_READY,
+  RESULT_CALIB_DONE,
+  RESULT_CALIB_ERROR,    // text = message
+  RESULT_CALIB_PROGRESS, // text = stage, value = ticks
+};
+
+struct MotionResult {
+  MotionResultType type;
+  uint8_t port;
+  int32_t value;
+  const char* text; // string literal
+};
+
+// Lock-free single-producer/single-consumer ring.
+// The encoder ISRs produce, the motion task is the only consumer. Every
+// producer ISR must run at interrupt level 1 (single core), so one push
+// always completes before another starts.
+template <typename T, uint32_t N>
+class EventRing {
+  static_assert((N & (N - 1)) == 0, "EventRing size must be a power of two");
+public:
+  // Called from ISR context - forced inline so it stays in IRAM with the caller
+  inline __attribute__((always_inline)) bool push(const T& item) {
+    uint32_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) >= N) {
+      overflows.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    buf[head & (N - 1)] = item;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool pop(T& item) {
+    uint32_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_.load(std::memory_order_acquire)) return false;
+    item = buf[tail & (N - 1)];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Events carry absolute counts, so a dropped event only skips a listener pass
+  std::atomic<uint32_t> overflows{0};
+
+private:
+  T buf[N];
+  std::atomic<uint32_t> head_{0};
+  std::atomic<uint32_t> tail_{0};
+};
+
+extern EventRing<EncoderEvent, 64> encoderEvents;
+
+// Single-writer sequence lock for a small multi-field record.
+// The writer makes the sequence odd, stores the words, then makes it even;
+// readers copy without locking and retry if the sequence moved under them.
+template <typename T>
+class Seqlock {
+  static_assert(std::is_trivially_copyable<T>::value, "Seqlock payload must be trivially copyable");
+  static constexpr uint32_t WORDS = (sizeof(T) + 3) / 4;
+public:
+  // Writer side - one task only
+  void write(const T& value) {
+    uint32_t words[WORDS] = {};
+    memcpy(words, &value, sizeof(T));
+    uint32_t seq = seq_.load(std::memory_order_relaxed);
+    seq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (uint32_t i = 0; i < WORDS; i++) data[i].store(words[i], std::memory_order_relaxed);
+    seq_.store(seq + 2, std::memory_order_release);
+  }
+
+  // Any task; never blocks the writer
+  T read() const {
+    uint32_t words[WORDS];
+    uint32_t before, after;
+    do {
+      before = seq_.load(std::memory_order_acquire);
+      for (uint32_t i = 0; i < WORDS; i++) words[i] = data[i].load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after = seq_.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+    T value;
+    memcpy(&value, words, sizeof(T));
+    return value;
+  }
+
+private:
+  std::atomic<uint32_t> data[WORDS] = {};
+  std::atomic<uint32_t> seq_{0};
+};
+
+// Worst-case time spent running encoder listeners for one detent (CPU cycles).
+// Before events were deferred this work ran inside the encoder ISR.
+extern std::atomic<uint32_t> listenerMaxCycles;
+
+// Valid moves superseded by a newer one for the same port before its control tick,
+// and commands of any kind lost to a full queue.
+extern std::atomic<uint32_t> movesCoalesced;
+extern std::atomic<uint32_t> commandsDropped;
+extern std::atomic<uint32_t> resultsDropped;
+
+void motionInit();
+void motionPostFromISR(uint8_t id, int32_t count);
+void motionWake();
+bool motionSubmit(MotionCommandType type, uint8_t port = 1, int32_t value = 0);
+bool motionSubmitCurve(uint8_t port, const uint16_t* knots);
+void motionLogStats();
+
+// Queue a result for the server without blocking (motion task)
+void motionReport(MotionResultType type, uint8_t port, const char* text = nullptr, int32_t value = 0);
+// Emit everything queued by motionReport (port task)
+void motionSendResults();
+
+#endif
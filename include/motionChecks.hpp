@@ -0,0 +1,90 @@
+#ifndef MOTIONCHECKS_H
+#define MOTIONCHECKS_H
+#include <stdint.h>
+
+// Stall supervision on motor encoder timing. Only counts and timestamps go
+// in, so it runs the same on the host.
+class StallMonitor {
+  public:
+    // The motor is being driven from rest. lastEdgeUs is the newest detent
+    // before this run, so a detent from an earlier run is never taken as progress.
+    void start(int64_t nowUs, uint32_t lastEdgeUs);
+    void stop() { running = false; }
+    bool isRunning() const { return running; }
+
+    // True once the motor has gone too long without a detent; sinceUs is how long.
+    // periodUs is the latest detent interval (0 if unknown), commandedVel the
+    // speed the motor is being asked for in ticks/s (0 if none).
+    bool stalled(int64_t nowUs, uint32_t lastEdgeUs, uint32_t periodUs, float commandedVel, uint32_t& sinceUs) const;
+
+    // Allowed gap between motor detents: a few detent periods at the slower of the
+    // commanded and last measured speed, so a jam is caught well before stallMaxMs.
+    static uint32_t thresholdUs(bool edgeThisRun, uint32_t periodUs, float commandedVel);
+
+  private:
+    bool running = false;
+    int64_t startUs = 0;
+    uint32_t startEdgeUs = 0;
+};
+
+enum SeekResult : uint8_t {
+  SEEK_RUNNING,
+  SEEK_FOUND,     // speed collapsed against the end stop
+  SEEK_NO_MOTION, // never got going after spin-up
+  SEEK_TIMEOUT,
+};
+
+// End stop detection for the calibration sweep: the speed collapses to a
+// fraction of the peak seen since the motor was started.
+class EndStopSeeker {
+  public:
+    void start(int64_t nowUs) { startUs = nowUs; peakVel = 0; }
+    // speed is the measured motor speed in ticks/s
+    SeekResult update(int64_t nowUs, float speed);
+    float getPeak() const { return peakVel; }
+
+  private:
+    int64_t startUs = 0;
+    float peakVel = 0;
+};
+
+// Feed-forward gain measured by the calibration sweep: the duty per tick/s
+// that held the sweep's peak speed at autoCalibDuty, averaged over both
+// directions. 0 if the result is implausible for this servo.
+float sweepFeedForward(float peakUp, float peakDown);
+
+// Statistics of one wand follow session
+struct FollowStats {
+  int64_t startUs;
+  int32_t startCount; // motor count when the session began
+  int32_t maxLag;     // largest wand-motor error, ticks
+  int32_t overshoot;  // furthest the motor ran past the wand, ticks
+  uint16_t starts;    // motor starts from rest
+};
+
+// Wand follow law: drive proportional to the wand-motor error plus the
+// wand's own speed through the speed loop's feed-forward gain, and the
+// session's tracking statistics. Only counts, speeds and times go in, so
+// it runs the same on the host.
+class WandFollow {
+  public:
+    // Error (wand minus motor, ticks) seen at a wand or motor detent
+    void observe(int32_t error);
+    // Signed duty toward the wand, 0 to stop; wandVel in milli-ticks/s.
+    // Inside the deadband a running motor keeps going while the wand still
+    // turns its way and it hasn't passed the wand, rather than stop and restart.
+    int32_t duty(int32_t error, int32_t wandVel, float kf, bool running) const;
+    // The motor is driven at duty: opens a session if none is active, and
+    // counts a start if the motor was at rest
+    void drive(int32_t error, int32_t duty, bool fromRest, int64_t nowUs, int32_t motorCount);
+    bool isActive() const { return active; }
+    // The motor has settled: close the session
+    FollowStats finish() { active = false; return stats; }
+
+  private:
+    bool active = false;
+    int8_t dir = 0; // direction of the last drive toward the wand
+    FollowStats stats = {};
+};
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef PCNTENCODER_H
+#define PCNTENCODER_H
+#include "encoder.hpp"
+#include "driver/pulse_cnt.h"
+
+// Hardware quadrature counter on the PCNT peripheral.
+// Edges are counted without CPU involvement; the CPU is only interrupted
+// when the counter crosses the armed watch point or wraps at its limits.
+class PcntEncoder : public Encoder {
+public:
+  PcntEncoder(gpio_num_t pinA, gpio_num_t pinB);
+  void init() override;
+  void deinit() override;
+  int32_t getCount() const override;
+  void setCount(int32_t value) override;
+  void setWatch(int32_t value) override;
+  bool poll(int32_t& value) override;
+
+  ~PcntEncoder();
+
+private:
+  static bool on_reach(pcnt_unit_handle_t unit, const pcnt_watch_event_data_t* edata, void* user_ctx);
+  int32_t countFromRaw(int32_t raw) const;
+
+  pcnt_unit_handle_t unit;
+  pcnt_channel_handle_t chan_a;
+  pcnt_channel_handle_t chan_b;
+
+  // Raw quarter steps accumulated across hardware counter wraps
+  std::atomic<int32_t> rawBase;
+  // Detent count corresponding to raw position 0
+  std::atomic<int32_t> offset;
+  // Hardware watch point currently armed for setWatch(), 0 if none
+  int watchRaw;
+  int32_t lastPolled;
+};
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef POSJOURNAL_H
+#define POSJOURNAL_H
+#include <atomic>
+#include <stdint.h>
+
+// Append-only log of servo positions in its own flash partition.
+// Each record carries a sequence number and CRC; boot recovery takes the
+// newest valid record per port. Saves are held in RAM until the position
+// has stopped changing, so a burst of moves costs one flash write.
+bool journalInit();
+bool journalRead(uint8_t port, int32_t& pos);
+bool journalSave(uint8_t port, int32_t pos); // false if there is no journal partition
+void journalFlush();                         // motion task, while no port is moving
+void journalLogStats();
+
+extern std::atomic<uint32_t> journalWrites;      // records written to flash
+extern std::atomic<uint32_t> journalWritesSaved; // saves coalesced or unchanged
+extern std::atomic<uint32_t> journalErases;      // sectors erased
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+#include <atomic>
+#include <stdint.h>
+
+struct PIDGains {
+  float kp; // duty per tick/s of velocity error
+  float ki; // duty per tick of integrated velocity error
+  float kd; // duty per tick/s^2 of velocity error change
+  float kf; // feed-forward duty per tick/s of reference velocity
+};
+
+// Trapezoidal velocity profile toward a target count, closed on measured
+// encoder velocity with a PID. The output is a signed duty offset from
+// offSpeed; positive drives the count up (CCW).
+class MotionProfile {
+  public:
+    // Safe to call from any task; the motion task picks it up on its next update.
+    void start(int32_t newTarget);
+    void stop() { active = false; }
+    bool isActive() const { return active; }
+    int32_t getTarget() const { return target; }
+    float getRefVelocity() const { return vRef; } // commanded speed, ticks/s (motion task)
+
+    // Advance one control period (motion task only). Returns false once the
+    // move has settled on target, otherwise the duty to apply.
+    bool update(int32_t pos, float velocity, float dt, const PIDGains& gains, int32_t& duty);
+
+    // Log time-to-target and overshoot for the move that just ended.
+    void report(int32_t pos);
+
+  private:
+    std::atomic<bool> active{false};
+    std::atomic<bool> restart{false};
+    std::atomic<int32_t> target{0};
+
+    float vRef = 0;
+    float integral = 0;
+    float prevError = 0;
+
+    int64_t startUs = 0;
+    int32_t startPos = 0;
+    bool movingUp = false;
+};
+
+#endif
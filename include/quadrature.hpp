@@ -0,0 +1,13 @@
+#ifndef QUADRATURE_H
+#define QUADRATURE_H
+#include <stdint.h>
+
+#define QUAD_ERR 2 // quadTable entry for an illegal double transition
+
+// Quadrature transition table, indexed by (prev AB << 2) | current AB.
+// +1/-1 is a single quarter step, 0 is no change, and QUAD_ERR marks an
+// illegal double transition (both pins changed between reads, direction unknown).
+// Lives in DRAM so the encoder ISR can read it with the flash cache disabled.
+extern const int8_t quadTable[16];
+
+#endif
@@ -1,41 +1,168 @@
 #ifndef SERVO_H
 #define SERVO_H
 #include <atomic>
+#include "driver/ledc.h"
 #include "calibration.hpp"
 #include "encoder.hpp"
+#include "profile.hpp"
+#include "motionChecks.hpp"
+#include "defines.h"
 
 #define CCW 1
 #define CW 0
 #define server 1
 #define manual 0
 
-extern std::atomic<bool> calibListen;
-extern std::atomic<bool> clearCalibFlag;
-extern std::atomic<bool> savePosFlag;
+// Wiring and storage of one blind
+struct PortConfig {
+  uint8_t num;              // port number used by the server (1-based)
+  gpio_num_t servoPin;
+  gpio_num_t switchPin;     // servo power switch
+  ledc_channel_t channel;
+  const char* nvsCalibNs;   // calibration and tuning namespace
+  const char* nvsServoNs;   // saved position namespace
+};
 
-extern Encoder* topEnc;
-extern Encoder* bottomEnc;
+// Soft start/stop durations, run by the LEDC fade unit
+struct RampProfile {
+  uint16_t startMs;
+  uint16_t stopMs;
+};
+
+// Counts, range and move state of one port as of its latest detent.
+// Published as a unit so readers never mix fields from different detents.
+struct MotionState {
+  int32_t topCount;
+  int32_t bottomCount;
+  int32_t upBound;
+  int32_t downBound;
+  int32_t baseDiff;
+  int32_t target;
+  int32_t lashShift; // motor count minus slat position
+  bool startLess;
+  uint16_t appPos; // slat position on the app scale, mapped by the motion task
+};
+
+// Per-port controller: motor encoder, wand encoder, calibration, NVS
+// namespaces, LEDC channel and all motion state for one blind.
+class BlindPort {
+  public:
+    BlindPort(const PortConfig& config, Encoder* top, Encoder* bottom);
+
+    const PortConfig cfg;
+    Encoder* topEnc;
+    Encoder* bottomEnc;
+    Calibration calib;
+    RampProfile ramp = {rampStartMs, rampStopMs};
+
+    std::atomic<bool> calibListen{false};
+    std::atomic<bool> clearCalibFlag{false};
+    std::atomic<bool> savePosFlag{false};
+    std::atomic<bool> movedOffline{false}; // a position the server didn't hear directly
+    std::atomic<bool> stallWatch{false}; // motor encoder supervised for stalls
+
+    void init();
+    void servoOn(uint8_t dir, uint8_t manOrServer);
+    void servoOff();
+    void servoSetSpeed(int32_t duty, uint8_t manOrServer, uint32_t rampMs = 0);
+    void servoMainSwitch(uint8_t onOff);
+    void servoPublishState(); // motion task, once per detent
+    MotionState getMotionState() const { return state.read(); }
+    MotionState servoSavePos();
+    int32_t servoReadPos();
+    void servoSnapshot();
+    void servoCalibListen();
+    bool servoInitCalib();
+    void servoPauseCalib();
+    bool servoBeginDownwardCalib();
+    bool servoCompleteCalib();
+    void servoCancelCalib();
+    bool servoAutoCalibStart();
+    bool servoAutoCalibActive() const { return autoPhase != AUTO_OFF; }
+    void servoAutoCalibTick();
+    void servoRampCheck();
+
+    void initMainLoop();
+    void servoStallCheck();
+    void stopServerRun();
+    void servoWandListen();
+    void servoServerListen();
+    void runToAppPos(uint16_t appPos);
+    bool servoProfileActive();
+    void servoProfileTick(float dt);
+    void servoCoastCheck();
+
+  private:
+    bool servoRestoreSnapshot(int32_t& pos);
+    void applyDuty(uint32_t duty, uint32_t rampMs);
+    void autoCalibDrive(uint8_t dir);
+    void autoCalibFail(const char* reason);
+    bool reachedCutPoint(int32_t topCount);
+    void servoServerStop(int32_t topCount);
+    void servoFollow(int32_t error, int32_t duty);
+    void followReport();
+    int32_t lashLead(int8_t dir);
+
+    // Owned by the motion task; other tasks see them through state
+    int32_t baseDiff = 0;
+    int32_t target = 0;
+    bool startLess = false;
+    int8_t driveDir = 0; // direction the slats were last driven (1 up, -1 down, 0 unknown)
+    Seqlock<MotionState> state;
+
+    std::atomic<bool> runningManual{false};
+    std::atomic<bool> runningServer{false};
+
+    int64_t fadeEndUs = 0;    // LEDC fade in progress until then
+    int64_t powerOffUs = 0;   // cut servo power once the stop ramp ends, 0 = none
+    uint32_t savedEdgeUs = 0; // last detent covered by a position save
+
+    MotionProfile profile;
+    StallMonitor stall; // running while the motor is driven
+
+    // Server stop awaiting its coast measurement
+    struct {
+      bool pending;
+      bool up;
+      int32_t cutPos;
+      int32_t goal;
+      float speed;
+      int64_t cutUs;
+    } coast = {};
+
+    // Automatic calibration: seek an end stop, back off, let it settle, record
+    enum AutoCalibPhase : uint8_t {
+      AUTO_OFF,
+      AUTO_SEEK_UP, AUTO_BACKOFF_UP, AUTO_SETTLE_UP,
+      AUTO_SEEK_DOWN, AUTO_BACKOFF_DOWN, AUTO_SETTLE_DOWN,
+    };
+    AutoCalibPhase autoPhase = AUTO_OFF;
+    int64_t autoPhaseUs = 0;
+    EndStopSeeker seek;
+    int32_t autoEndStop = 0;
+    float autoPeakUp = 0; // peak speed of each sweep, ticks/s
+    float autoPeakDown = 0;
+
+    WandFollow follow; // current session, reported once the motor settles
+
+    // Server move that reversed direction, open for a backlash sample until untilUs
+    struct {
+      int8_t dir;
+      int64_t untilUs;
+      int32_t target; // motor target of that move
+    } lashSample = {};
+
+    // Final stop error in ticks past target: <=-3, -2, -1, 0, 1, 2, >=3
+    uint32_t stopErrorHist[7] = {};
+};
+
+extern BlindPort ports[NUM_PORTS];
+
+// Port by server port number, nullptr if this device doesn't have it
+BlindPort* getPort(int num);
 
 void servoInit();
-void servoOn(uint8_t dir, uint8_t manOrServer);
-void servoOff();
-void servoMainSwitch(uint8_t onOff);
-void servoSavePos();
-void servoCalibListen();
-bool servoInitCalib();
-bool servoBeginDownwardCalib();
-bool servoCompleteCalib();
-void servoCancelCalib();
 void debugLEDSwitch(uint8_t onOff);
 void debugLEDTgl();
 
-void initMainLoop();
-void watchdogCallback(void* arg);
-void servoSavePos();
-int32_t servoReadPos();
-void stopServerRun();
-void servoWandListen();
-void servoServerListen();
-void runToAppPos(uint8_t appPos);
-
-#endif
\ No newline at end of file
+#endif
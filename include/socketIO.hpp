@@ -1,6 +1,7 @@
 #ifndef SOCKETIO_HPP
 #define SOCKETIO_HPP
 #include <atomic>
+#include <stdint.h>
 
 extern std::atomic<bool> statusResolved;
 extern std::atomic<bool> connected;
@@ -17,6 +18,12 @@ void emitCalibStage1Ready(int port = 1);
 void emitCalibStage2Ready(int port = 1);
 void emitCalibDone(int port = 1);
 void emitCalibError(const char* errorMessage, int port = 1);
-void emitPosHit(int pos, int port = 1);
+void emitCalibProgress(const char* stage, int32_t ticks, int port = 1);
+// True if it went straight to the server, false if it was queued or lost
+bool emitPosHit(int pos, int port = 1);
+
+// Log per-event call counts and handler time, and emit counts and heap use,
+// for whatever changed since the last call
+void socketLogStats();
 
 #endif // SOCKETIO_HPP
\ No newline at end of file
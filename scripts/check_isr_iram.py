@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+"""Warn when code reachable from an encoder ISR lives in flash.
+
+Walks the direct call graph of the ISR roots in the linked ELF (objdump -d)
+and reports every reachable function or data reference placed in the
+flash-mapped IROM/DROM windows. Those fault or stall while the cache is
+disabled for NVS and journal writes.
+
+Indirect calls (the bank ISR's per-encoder decoder pointers) can't be
+followed, so their targets are listed as roots too. Library code (IDF,
+newlib, libstdc++) that is already in IRAM is not descended into: IDF
+places its ISR-safe functions there, and their own callees in flash are
+assert and log paths that would only be noise here.
+
+Findings are warnings unless --strict is given. A missing objdump skips
+the check rather than failing the build.
+
+usage: check_isr_iram.py [--objdump PATH] [--strict] firmware.elf
+"""
+import argparse
+import re
+import shutil
+import subprocess
+import sys
+
+# ESP32-C6 flash-mapped instruction and data windows
+FLASH_RANGES = [(0x42000000, 0x44000000)]
+
+# Demangled names (regex, matched from the start) of every ISR entry point
+DEFAULT_ROOTS = [
+    r"GpioEncoder::bank_isr\(",
+    r"PinnedEncoder<.*>::decode\(",
+    r"PcntEncoder::on_reach\(",
+    r"motionPostFromISR\(",
+]
+
+FUNC_RE = re.compile(r"^([0-9a-f]+) <(.+)>:$")
+INSN_RE = re.compile(r"^\s*([0-9a-f]+):\s+(\S+)\s*(.*)$")
+# Greedy up to the operand's last '>': template symbols nest angle brackets
+REF_RE = re.compile(r"\b([0-9a-f]{8}) <(.+)>")
+OFFSET_RE = re.compile(r"\+0x[0-9a-f]+$")
+JUMPS = {"jal", "j", "jalr", "c.jal", "c.j", "call", "tail"}
+
+
+def in_flash(addr):
+    return any(lo <= addr < hi for lo, hi in FLASH_RANGES)
+
+
+def is_library(name):
+    # Project code is C++, so it demangles with a parameter list; IDF and
+    # newlib are C
+    return "(" not in name or name.startswith(("std::", "__gnu_cxx::", "__cxxabiv1::"))
+
+
+def parse(objdump, elf):
+    out = subprocess.run([objdump, "-d", "-C", "--no-show-raw-insn", elf],
+                         check=True, capture_output=True, text=True).stdout
+    funcs = {}  # name -> (addr, [(addr, symbol, is_call)])
+    current = None
+    for line in out.splitlines():
+        m = FUNC_RE.match(line)
+        if m:
+            current = m.group(2)
+            funcs[current] = (int(m.group(1), 16), [])
+            continue
+        m = INSN_RE.match(line)
+        if not m or current is None:
+            continue
+        mnemonic, operands = m.group(2), m.group(3)
+        ref = REF_RE.search(operands)
+        if ref:
+            symbol = OFFSET_RE.sub("", ref.group(2))
+            if symbol == current:
+                continue  # branch within the function
+            funcs[current][1].append((int(ref.group(1), 16), symbol, mnemonic in JUMPS))
+    return funcs
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("elf")
+    parser.add_argument("--objdump", default="riscv32-esp-elf-objdump")
+    parser.add_argument("--root", action="append", help="extra ISR root (regex)")
+    parser.add_argument("--strict", action="store_true", help="exit 1 on findings")
+    args = parser.parse_args()
+
+    if shutil.which(args.objdump) is None:
+        print("check_isr_iram: warning: %s not found, ISR placement not checked" % args.objdump,
+              file=sys.stderr)
+        return 0
+    funcs = parse(args.objdump, args.elf)
+    # call targets are function entry points; resolving them by address
+    # doesn't depend on how the demangled name printed
+    by_addr = {addr: name for name, (addr, _) in funcs.items()}
+    patterns = [re.compile(r) for r in DEFAULT_ROOTS + (args.root or [])]
+    roots = [name for name in funcs if any(p.match(name) for p in patterns)]
+    if not roots:
+        print("check_isr_iram: warning: no ISR roots found in %s" % args.elf, file=sys.stderr)
+        return 1 if args.strict else 0
+
+    errors = []
+    seen = set()
+    stack = [(name, [name]) for name in roots]
+    while stack:
+        name, path = stack.pop()
+        if name in seen:
+            continue
+        seen.add(name)
+        addr, refs = funcs[name]
+        if in_flash(addr):
+            errors.append("%s is in flash (0x%08x)\n    via %s" % (name, addr, " -> ".join(path)))
+            continue
+        if is_library(name) and name not in roots:
+            continue
+        for ref_addr, symbol, is_call in refs:
+            target = by_addr.get(ref_addr, symbol)
+            if is_call and target in funcs:
+                stack.append((target, path + [target]))
+            elif in_flash(ref_addr):
+                errors.append("%s references flash %s (0x%08x)\n    via %s"
+                              % (name, symbol, ref_addr, " -> ".join(path)))
+
+    if errors:
+        print("check_isr_iram: warning: flash-resident code or data reachable from an ISR:", file=sys.stderr)
+        for err in errors:
+            print("  " + err, file=sys.stderr)
+        return 1 if args.strict else 0
+    print("check_isr_iram: %d ISR roots, %d functions checked, all in IRAM" % (len(roots), len(seen)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
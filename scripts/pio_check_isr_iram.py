@@ -0,0 +1,13 @@
+# PlatformIO post-build hook: run check_isr_iram.py on the linked firmware.
+# Warnings only; the build result doesn't depend on it.
+Import("env")
+import os
+import re
+
+def check_isr_iram(source, target, env):
+    script = os.path.join(env.subst("$PROJECT_DIR"), "scripts", "check_isr_iram.py")
+    objdump = re.sub(r"gcc(\.exe)?$", r"objdump\1", env.subst("$CC"))
+    cmd = '"$PYTHONEXE" "%s" --objdump "%s" "%s"' % (script, objdump, target[0].get_abspath())
+    env.Execute(cmd)
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", check_isr_iram)
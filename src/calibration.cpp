@@ -1,10 +1,17 @@
 #include "calibration.hpp"
 #include "defines.h"
 #include "nvs_flash.h"
+#include <math.h>
+#include <string.h>
 
 void Calibration::init() {
+  gains = {defaultKp, defaultKi, defaultKd, defaultKf};
+  coastUp = coastDown = defaultCoast;
+  lashUp = lashDown = defaultLash;
+  for (uint8_t i = 0; i < curveKnots; i++) curve[i] = i * 1000 / (curveKnots - 1); // linear
   nvs_handle_t calibHandle;
-  if (nvs_open(nvsCalib, NVS_READONLY, &calibHandle) == ESP_OK) {
+  if (nvs_open(nvsNamespace, NVS_READONLY, &calibHandle) == ESP_OK) {
+    loadTuning(calibHandle);
     int32_t tempUpTicks;
     int32_t tempDownTicks;
     uint8_t tempCalib;
@@ -28,6 +35,11 @@ void Calibration::init() {
     printf("CALIBINIT: failed to open NVS - not created?\n");
     calibrated = false;
   }
+  savedCoastUp = coastUp;
+  savedCoastDown = coastDown;
+  savedLashUp = lashUp;
+  savedLashDown = lashDown;
+  buildMap();
 }
 
 bool Calibration::clearCalibrated() {
@@ -35,7 +47,7 @@ bool Calibration::clearCalibrated() {
   // clear variable and NVS
   calibrated = false;
   nvs_handle_t calibHandle;
-  if (nvs_open(nvsCalib, NVS_READWRITE, &calibHandle) == ESP_OK) {
+  if (nvs_open(nvsNamespace, NVS_READWRITE, &calibHandle) == ESP_OK) {
     if (nvs_set_u8(calibHandle, statusTag, false) != ESP_OK) {
       printf("Error saving calibration status as false.\n");
       return false;
@@ -50,10 +62,10 @@ bool Calibration::clearCalibrated() {
   return true;
 }
 
-bool Calibration::beginDownwardCalib(Encoder& topEnc) {
-  int32_t tempUpTicks = topEnc.getCount();
+bool Calibration::beginDownwardCalib(int32_t count) {
+  int32_t tempUpTicks = count;
   nvs_handle_t calibHandle;
-  if (nvs_open(nvsCalib, NVS_READWRITE, &calibHandle) == ESP_OK) {
+  if (nvs_open(nvsNamespace, NVS_READWRITE, &calibHandle) == ESP_OK) {
     if (nvs_set_i32(calibHandle, UpTicksTag, tempUpTicks) == ESP_OK) {
       printf("Saved UpTicks to NVS\n");
       UpTicks = tempUpTicks;
@@ -72,22 +84,23 @@ bool Calibration::beginDownwardCalib(Encoder& topEnc) {
   return true;
 }
 
-bool Calibration::completeCalib(Encoder& topEnc) {
-  int32_t tempDownTicks = topEnc.getCount();
+bool Calibration::completeCalib(int32_t count) {
+  int32_t tempDownTicks = count;
   if (tempDownTicks == UpTicks) {
     printf("ERROR: NO RANGE\n");
     return false;
   }
   nvs_handle_t calibHandle;
-  if (nvs_open(nvsCalib, NVS_READWRITE, &calibHandle) == ESP_OK) {
+  if (nvs_open(nvsNamespace, NVS_READWRITE, &calibHandle) == ESP_OK) {
     esp_err_t err = ESP_OK;
     err |= nvs_set_i32(calibHandle, DownTicksTag, tempDownTicks);
     err |= nvs_set_u8(calibHandle, statusTag, true);
-    if (err != ESP_OK) {
+    if (err != ESP_OK || !storeTuning(calibHandle)) {
       printf("Error saving calibration data.\n");
       return false;
     }
     DownTicks = tempDownTicks;
+    buildMap();
     calibrated = true;
     printf("Range: %d - %d\n", UpTicks.load(), tempDownTicks);
     nvs_commit(calibHandle);
@@ -100,13 +113,162 @@ bool Calibration::completeCalib(Encoder& topEnc) {
   return true;
 }
 
-int32_t Calibration::convertToTicks(uint8_t appPos) {
-  // appPos between 0 and 10, convert to target encoder ticks.
-  return (((int32_t)appPos * (UpTicks - DownTicks)) / 10) + DownTicks;
+// Knots must start at 0, end at 1000 and never decrease
+static bool curveValid(const uint16_t* knots) {
+  if (knots[0] != 0 || knots[curveKnots - 1] != 1000) return false;
+  for (uint8_t i = 1; i < curveKnots; i++)
+    if (knots[i] < knots[i - 1]) return false;
+  return true;
+}
+
+bool Calibration::curveFromKnots(const int32_t* values, uint16_t* knots) {
+  for (uint8_t i = 0; i < curveKnots; i++) {
+    if (values[i] < 0 || values[i] > 1000) return false;
+    knots[i] = (uint16_t)values[i];
+  }
+  return curveValid(knots);
+}
+
+void Calibration::loadTuning(nvs_handle_t calibHandle) {
+  // tuning is optional - keep defaults for anything missing
+  int32_t val;
+  if (nvs_get_i32(calibHandle, kpTag, &val) == ESP_OK) gains.kp = val / 1000.0f;
+  if (nvs_get_i32(calibHandle, kiTag, &val) == ESP_OK) gains.ki = val / 1000.0f;
+  if (nvs_get_i32(calibHandle, kdTag, &val) == ESP_OK) gains.kd = val / 1000.0f;
+  if (nvs_get_i32(calibHandle, kfTag, &val) == ESP_OK) gains.kf = val / 1000.0f;
+  if (nvs_get_i32(calibHandle, coastUpTag, &val) == ESP_OK) coastUp = val / 1000.0f;
+  if (nvs_get_i32(calibHandle, coastDownTag, &val) == ESP_OK) coastDown = val / 1000.0f;
+  if (nvs_get_i32(calibHandle, lashUpTag, &val) == ESP_OK) lashUp = val / 1000.0f;
+  if (nvs_get_i32(calibHandle, lashDownTag, &val) == ESP_OK) lashDown = val / 1000.0f;
+
+  uint16_t knots[curveKnots];
+  size_t len = sizeof(knots);
+  if (nvs_get_blob(calibHandle, curveTag, knots, &len) == ESP_OK && len == sizeof(knots)) {
+    if (curveValid(knots)) memcpy(curve, knots, sizeof(knots));
+    else printf("Stored position curve invalid - using linear\n");
+  }
+}
+
+bool Calibration::storeTuning(nvs_handle_t calibHandle) {
+  esp_err_t err = ESP_OK;
+  err |= nvs_set_i32(calibHandle, kpTag, (int32_t)(gains.kp * 1000));
+  err |= nvs_set_i32(calibHandle, kiTag, (int32_t)(gains.ki * 1000));
+  err |= nvs_set_i32(calibHandle, kdTag, (int32_t)(gains.kd * 1000));
+  err |= nvs_set_i32(calibHandle, kfTag, (int32_t)(gains.kf * 1000));
+  err |= nvs_set_i32(calibHandle, coastUpTag, (int32_t)(coastUp * 1000));
+  err |= nvs_set_i32(calibHandle, coastDownTag, (int32_t)(coastDown * 1000));
+  err |= nvs_set_i32(calibHandle, lashUpTag, (int32_t)(lashUp * 1000));
+  err |= nvs_set_i32(calibHandle, lashDownTag, (int32_t)(lashDown * 1000));
+  if (err != ESP_OK) printf("Error saving speed loop tuning.\n");
+  else {
+    savedCoastUp = coastUp;
+    savedCoastDown = coastDown;
+    savedLashUp = lashUp;
+    savedLashDown = lashDown;
+  }
+  return err == ESP_OK;
+}
+
+bool Calibration::saveGains(const PIDGains& newGains) {
+  gains = newGains;
+  nvs_handle_t calibHandle;
+  if (nvs_open(nvsNamespace, NVS_READWRITE, &calibHandle) != ESP_OK) {
+    printf("Error opening calibration NVS segment.\n");
+    return false;
+  }
+  bool ok = storeTuning(calibHandle);
+  if (ok) nvs_commit(calibHandle);
+  nvs_close(calibHandle);
+  return ok;
+}
+
+bool Calibration::saveCoast() {
+  // Only write flash once the model has moved noticeably from what's stored
+  if (fabsf(coastUp - savedCoastUp) <= savedCoastUp * coastSaveChange
+      && fabsf(coastDown - savedCoastDown) <= savedCoastDown * coastSaveChange) return true;
+  nvs_handle_t calibHandle;
+  if (nvs_open(nvsNamespace, NVS_READWRITE, &calibHandle) != ESP_OK) {
+    printf("Error opening calibration NVS segment.\n");
+    return false;
+  }
+  bool ok = storeTuning(calibHandle);
+  if (ok) nvs_commit(calibHandle);
+  nvs_close(calibHandle);
+  return ok;
+}
+
+bool Calibration::saveLash() {
+  if (fabsf(lashUp - savedLashUp) < lashSaveChange
+      && fabsf(lashDown - savedLashDown) < lashSaveChange) return true;
+  nvs_handle_t calibHandle;
+  if (nvs_open(nvsNamespace, NVS_READWRITE, &calibHandle) != ESP_OK) {
+    printf("Error opening calibration NVS segment.\n");
+    return false;
+  }
+  bool ok = storeTuning(calibHandle);
+  if (ok) nvs_commit(calibHandle);
+  nvs_close(calibHandle);
+  return ok;
 }
 
-uint8_t Calibration::convertToAppPos(int32_t ticks) {
-  // appPos between 0 and 10, convert to target encoder ticks.
-  int8_t retVal = (ticks - DownTicks) * 10 / (UpTicks - DownTicks);
-  return (retVal < 0) ? 0 : ((retVal > 10) ? 10 : retVal);
-}
\ No newline at end of file
+bool Calibration::saveCurve(const uint16_t* knots) {
+  if (!curveValid(knots)) {
+    printf("Rejected position curve - must rise from 0 to 1000\n");
+    return false;
+  }
+  nvs_handle_t calibHandle;
+  if (nvs_open(nvsNamespace, NVS_READWRITE, &calibHandle) != ESP_OK) {
+    printf("Error opening calibration NVS segment.\n");
+    return false;
+  }
+  bool ok = nvs_set_blob(calibHandle, curveTag, knots, sizeof(curve)) == ESP_OK;
+  if (ok) {
+    nvs_commit(calibHandle);
+    memcpy(curve, knots, sizeof(curve));
+    buildMap();
+  }
+  else printf("Error saving position curve.\n");
+  nvs_close(calibHandle);
+  return ok;
+}
+
+// Precompute knot positions and fixed-point reciprocals so conversions need
+// only multiplies and shifts. Call whenever the range or curve changes.
+void Calibration::buildMap() {
+  int32_t range = UpTicks - DownTicks;
+  rangeDir = (range < 0) ? -1 : 1;
+  uint32_t span = (range < 0) ? -range : range;
+  for (uint8_t i = 0; i < curveKnots; i++)
+    knotOffset[i] = (int32_t)(((uint64_t)span * curve[i] + 500) / 1000);
+  for (uint8_t i = 0; i < curveKnots - 1; i++) {
+    uint32_t ticks = knotOffset[i + 1] - knotOffset[i];
+    spanRecip[i] = ticks ? (uint32_t)(((1ULL << 32) + ticks - 1) / ticks) : 0;
+  }
+  // rounded up so exact knot positions never land just below their segment
+  appToKnot = (((uint64_t)(curveKnots - 1) << 32) + posResolution - 1) / posResolution;
+  knotToApp = (uint32_t)((((uint64_t)posResolution << 16) + (curveKnots - 1) / 2) / (curveKnots - 1));
+}
+
+int32_t Calibration::convertToTicks(uint16_t appPos) {
+  // appPos between 0 and posResolution, convert to target encoder ticks.
+  if (appPos >= posResolution) return DownTicks + rangeDir * knotOffset[curveKnots - 1];
+  uint32_t x = (uint32_t)((appPos * appToKnot) >> 16); // knot index, Q16
+  uint32_t seg = x >> 16;
+  uint32_t frac = x & 0xFFFF;
+  int32_t segTicks = knotOffset[seg + 1] - knotOffset[seg];
+  int32_t offset = knotOffset[seg] + (int32_t)(((uint64_t)segTicks * frac + 0x8000) >> 16);
+  return DownTicks + rangeDir * offset;
+}
+
+uint16_t Calibration::convertToAppPos(int32_t ticks) {
+  // encoder ticks to the nearest app position between 0 and posResolution.
+  int32_t offset = (ticks - DownTicks) * rangeDir;
+  if (offset <= 0) return 0;
+  if (offset >= knotOffset[curveKnots - 1]) return posResolution;
+  uint32_t seg = 0;
+  while (seg < curveKnots - 2 && offset >= knotOffset[seg + 1]) seg++; // skips empty segments too
+  uint32_t frac = (uint32_t)(((uint64_t)(offset - knotOffset[seg]) * spanRecip[seg]) >> 16);
+  if (frac > 0xFFFF) frac = 0xFFFF;
+  uint64_t x = ((uint64_t)seg << 16) | frac; // knot index, Q16
+  return (uint16_t)((x * knotToApp + (1ULL << 31)) >> 32);
+}
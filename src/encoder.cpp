@@ -2,129 +2,165 @@
 #include "driver/gpio.h"
 #include "esp_log.h"
 #include "soc/gpio_struct.h"
-#include "servo.hpp"
+#include "hal/gpio_ll.h"
+#include "esp_cpu.h"
+#include "motion.hpp"
+#include "defines.h"
 
 static const char *TAG = "ENCODER";
 
-// Constructor
+Encoder* Encoder::registry[MAX_ENCODERS] = {};
+uint8_t Encoder::registered = 0;
+std::atomic<uint32_t> Encoder::isrMaxCycles{0};
+
+// Constructors
 Encoder::Encoder(gpio_num_t pinA, gpio_num_t pinB) 
-    : pin_a(pinA), pin_b(pinB), count(0), 
-      last_state_a(0), last_state_b(0), last_count_base(0),
-      watchdog_handle(nullptr) {}
+    : errors(0), pin_a(pinA), pin_b(pinB), id(MAX_ENCODERS),
+      port(nullptr), edges{}, edgeHead(0), velocity(0), lastEdgeUs(0) {}
 
-// Static ISR - receives Encoder instance via arg
-void IRAM_ATTR Encoder::isr_handler(void* arg)
-{
-  Encoder* encoder = static_cast<Encoder*>(arg);
-  
-  // Read GPIO levels directly from hardware
-  uint32_t gpio_levels = GPIO.in.val;
-  uint8_t current_a = (gpio_levels >> encoder->pin_a) & 0x1;
-  uint8_t current_b = (gpio_levels >> encoder->pin_b) & 0x1;
-
-  // Quadrature decoding logic
-  if (current_a != encoder->last_state_a) {
-    if (!current_a) { 
-      if (current_b) encoder->last_count_base++;
-      else encoder->last_count_base--;
-    }
-    else { 
-      if (current_b) encoder->last_count_base--;
-      else encoder->last_count_base++;
-    }
-  }
-  else if (current_b != encoder->last_state_b) {
-    if (!current_b) { 
-      if (current_a) encoder->last_count_base--;
-      else encoder->last_count_base++;
-    }
-    else { 
-      if (current_a) encoder->last_count_base++;
-      else encoder->last_count_base--;
-    }
-  }
-  
-  // Accumulate to full detent count
-  if (encoder->last_count_base > 3) {
-    encoder->count += 1;
-    encoder->last_count_base -= 4;
-    if (calibListen) servoCalibListen();
-    if (encoder->feedWDog) {
-      esp_timer_stop(encoder->watchdog_handle);
-      esp_timer_start_once(encoder->watchdog_handle, 500000);
-      debugLEDTgl();
-    }
-    if (encoder->wandListen) servoWandListen();
-    if (encoder->serverListen) servoServerListen();
-  }
-  else if (encoder->last_count_base < 0) {
-    encoder->count -= 1;
-    encoder->last_count_base += 4;
-    if (calibListen) servoCalibListen();
-    if (encoder->feedWDog) {
-      esp_timer_stop(encoder->watchdog_handle);
-      esp_timer_start_once(encoder->watchdog_handle, 500000);
-      debugLEDTgl();
-    }
-    if (encoder->wandListen) servoWandListen();
-    if (encoder->serverListen) servoServerListen();
+GpioEncoder::GpioEncoder(gpio_num_t pinA, gpio_num_t pinB, gpio_pull_mode_t pull, DecodeFn decode)
+    : Encoder(pinA, pinB), count(0), pin_mask((1UL << pinA) | (1UL << pinB)),
+      pull(pull), decodeFn(decode), last_count_base(0) {}
+
+bool Encoder::registerInstance() {
+  if (id < MAX_ENCODERS) return true;
+  if (registered >= MAX_ENCODERS) {
+    ESP_LOGE(TAG, "Too many encoders registered");
+    return false;
   }
-  
-  encoder->last_state_a = current_a;
-  encoder->last_state_b = current_b;
+  id = registered++;
+  registry[id] = this;
+  return true;
+}
+
+// Encoder bank shared by every GpioEncoder. Written with interrupts
+// disabled (single core), read only by bank_isr.
+static GpioEncoder* bankEncoders[MAX_ENCODERS];
+static uint8_t bankSize = 0;
+static uint32_t bankPinMask = 0;
+static uint32_t bankLevels = 0; // previous GPIO.in snapshot
+static gpio_isr_handle_t bankHandle = NULL;
+static portMUX_TYPE bankLock = portMUX_INITIALIZER_UNLOCKED;
+
+// Raw GPIO ISR - one snapshot, one edge mask, and only encoders whose pins
+// changed are decoded. Replaces the per-pin IDF GPIO ISR service dispatch.
+void IRAM_ATTR GpioEncoder::bank_isr(void* arg)
+{
+#if isrProfiling
+  uint32_t startCycles = esp_cpu_get_cycle_count();
+#endif
+  // Clear before sampling so an edge after the read re-triggers the interrupt
+  gpio_ll_clear_intr_status(&GPIO, bankPinMask);
+  uint32_t levels = GPIO.in.val;
+  decodeBank(bankEncoders, bankSize, bankPinMask, bankLevels, levels);
+  bankLevels = levels;
+
+#if isrProfiling
+  uint32_t elapsed = esp_cpu_get_cycle_count() - startCycles;
+  if (elapsed > isrMaxCycles.load(std::memory_order_relaxed))
+    isrMaxCycles.store(elapsed, std::memory_order_relaxed);
+#endif
 }
 
-void Encoder::init()
+void GpioEncoder::init()
 {
+    if (!registerInstance()) return;
+
+    // Interrupts stay off until the pins are in bankPinMask, or bank_isr
+    // could never clear their status and the level interrupt would re-fire
     gpio_config_t io_conf = {};
-    io_conf.intr_type = GPIO_INTR_ANYEDGE;
-    io_conf.pin_bit_mask = (1ULL << pin_a) | (1ULL << pin_b);
+    io_conf.intr_type = GPIO_INTR_DISABLE;
+    io_conf.pin_bit_mask = pin_mask;
     io_conf.mode = GPIO_MODE_INPUT;
-    io_conf.pull_up_en = GPIO_PULLUP_ENABLE; 
-    io_conf.pull_down_en = GPIO_PULLDOWN_DISABLE;
+    io_conf.pull_up_en = (pull == GPIO_PULLUP_ONLY || pull == GPIO_PULLUP_PULLDOWN)
+                         ? GPIO_PULLUP_ENABLE : GPIO_PULLUP_DISABLE;
+    io_conf.pull_down_en = (pull == GPIO_PULLDOWN_ONLY || pull == GPIO_PULLUP_PULLDOWN)
+                           ? GPIO_PULLDOWN_ENABLE : GPIO_PULLDOWN_DISABLE;
     gpio_config(&io_conf);
 
-    // Install ISR service if not already installed
-    gpio_install_isr_service(ESP_INTR_FLAG_LEVEL1);
+    // The bank ISR owns the GPIO interrupt, so the IDF GPIO ISR service must not be installed
+    if (bankHandle == NULL)
+      ESP_ERROR_CHECK(gpio_isr_register(GpioEncoder::bank_isr, NULL,
+                                        ESP_INTR_FLAG_LEVEL1 | ESP_INTR_FLAG_IRAM, &bankHandle));
 
-    // Attach ISR with THIS instance as argument
-    gpio_isr_handler_add(pin_a, Encoder::isr_handler, this);
-    gpio_isr_handler_add(pin_b, Encoder::isr_handler, this);
+    portENTER_CRITICAL(&bankLock);
+    bool present = false;
+    for (uint8_t i = 0; i < bankSize; i++) present |= (bankEncoders[i] == this);
+    if (!present && bankSize < MAX_ENCODERS) {
+      bankEncoders[bankSize++] = this;
+      bankPinMask |= pin_mask;
+      // Seed from the current pin levels so the first edge decodes correctly
+      bankLevels = (bankLevels & ~pin_mask) | (GPIO.in.val & pin_mask);
+    }
+    gpio_ll_clear_intr_status(&GPIO, pin_mask);
+    portEXIT_CRITICAL(&bankLock);
+
+    gpio_set_intr_type(pin_a, GPIO_INTR_ANYEDGE);
+    gpio_set_intr_type(pin_b, GPIO_INTR_ANYEDGE);
+    gpio_intr_enable(pin_a);
+    gpio_intr_enable(pin_b);
 
     ESP_LOGI(TAG, "Encoder initialized on pins %d and %d", pin_a, pin_b);
 }
 
-void Encoder::deinit()
+void GpioEncoder::deinit()
 {
-    gpio_isr_handler_remove(pin_a);
-    gpio_isr_handler_remove(pin_b);
+    gpio_intr_disable(pin_a);
+    gpio_intr_disable(pin_b);
+
+    portENTER_CRITICAL(&bankLock);
+    for (uint8_t i = 0; i < bankSize; i++) {
+      if (bankEncoders[i] == this) {
+        bankEncoders[i] = bankEncoders[--bankSize];
+        bankPinMask &= ~pin_mask;
+        break;
+      }
+    }
+    portEXIT_CRITICAL(&bankLock);
     ESP_LOGI(TAG, "Encoder deinitialized");
 }
 
-void Encoder::setupWatchdog() {
-  if (watchdog_handle == NULL) {
-    const esp_timer_create_args_t enc_watchdog_args = {
-      .callback = &watchdogCallback,
-      .dispatch_method = ESP_TIMER_ISR,
-      .name = "encoder_wdt",
-    };
+// Without a new detent the speed can't exceed one tick per elapsed interval,
+// so a stopped encoder decays toward zero instead of holding its last speed.
+static int32_t boundVelocity(int32_t v, uint32_t sinceUs) {
+  if (sinceUs == 0) return v;
+  int32_t bound = (int32_t)(1000000000LL / sinceUs);
+  return (v > bound) ? bound : ((v < -bound) ? -bound : v);
+}
 
-    ESP_ERROR_CHECK(esp_timer_create(&enc_watchdog_args, &watchdog_handle));
-  }
+static int32_t clampToInt32(int64_t v) {
+  return (v > INT32_MAX) ? INT32_MAX : ((v < INT32_MIN) ? INT32_MIN : (int32_t)v);
+}
 
-  ESP_ERROR_CHECK(esp_timer_start_once(watchdog_handle, 500000));
-  feedWDog = true;
+void Encoder::recordEdge(int32_t count, uint32_t timeUs) {
+  uint32_t head = edgeHead.load(std::memory_order_relaxed);
+  if (head > 0) {
+    const EdgeSample& prev = edges[(head - 1) & (EDGE_HISTORY - 1)];
+    uint32_t dt = timeUs - prev.timeUs;
+    int32_t dc = count - prev.count;
+    if (dc == 0 || dt == 0) return;
+
+    // First-order IIR (1/4 weight) on the instantaneous rate
+    int32_t prevVel = boundVelocity(velocity, dt);
+    int32_t instVel = clampToInt32((int64_t)dc * 1000000000LL / dt);
+    velocity = prevVel + (instVel - prevVel) / 4;
+  }
+  edges[head & (EDGE_HISTORY - 1)] = {count, timeUs};
+  edgeHead.store(head + 1, std::memory_order_release);
+  lastEdgeUs = timeUs;
 }
 
-void IRAM_ATTR Encoder::pauseWatchdog() {
-  if (watchdog_handle != nullptr) esp_timer_stop(watchdog_handle);
-  feedWDog = false;
+int32_t Encoder::getVelocity() const {
+  if (edgeHead.load(std::memory_order_acquire) == 0) return 0;
+  return boundVelocity(velocity, (uint32_t)esp_timer_get_time() - lastEdgeUs);
 }
 
-Encoder::~Encoder() {
-  if (watchdog_handle != NULL) {
-    esp_timer_stop(watchdog_handle);
-    esp_timer_delete(watchdog_handle);
-    watchdog_handle = NULL;
+uint8_t Encoder::getEdges(EdgeSample* out, uint8_t max) const {
+  uint32_t head = edgeHead.load(std::memory_order_acquire);
+  uint8_t n = 0;
+  while (n < max && n < EDGE_HISTORY && n < head) {
+    out[n] = edges[(head - 1 - n) & (EDGE_HISTORY - 1)];
+    n++;
   }
-}
\ No newline at end of file
+  return n;
+}
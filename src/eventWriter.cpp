@@ -0,0 +1,87 @@
+#include "eventWriter.hpp"
+
+// "4" engine.io message, "2" socket.io event, default namespace
+EventWriter::EventWriter(char* buffer, size_t size, const char* event)
+    : buf(buffer), size(size), len(0), firstField(true), overflow(false) {
+  putRaw("42[");
+  putQuoted(event);
+  putRaw(",{");
+}
+
+void EventWriter::put(char c) {
+  if (len + 1 >= size) {
+    overflow = true;
+    return;
+  }
+  buf[len++] = c;
+}
+
+void EventWriter::putRaw(const char* s) {
+  while (*s) put(*s++);
+}
+
+// String escaping as cJSON does it
+void EventWriter::putQuoted(const char* s) {
+  static const char hex[] = "0123456789abcdef";
+  put('"');
+  for (; *s; s++) {
+    uint8_t c = *s;
+    switch (c) {
+      case '"': putRaw("\\\""); break;
+      case '\\': putRaw("\\\\"); break;
+      case '\b': putRaw("\\b"); break;
+      case '\f': putRaw("\\f"); break;
+      case '\n': putRaw("\\n"); break;
+      case '\r': putRaw("\\r"); break;
+      case '\t': putRaw("\\t"); break;
+      default:
+        if (c < 0x20) {
+          putRaw("\\u00");
+          put(hex[c >> 4]);
+          put(hex[c & 0xF]);
+        }
+        else put(c);
+    }
+  }
+  put('"');
+}
+
+void EventWriter::putKey(const char* key) {
+  if (!firstField) put(',');
+  firstField = false;
+  putQuoted(key);
+  put(':');
+}
+
+EventWriter& EventWriter::addNumber(const char* key, int32_t value) {
+  putKey(key);
+  char digits[11];
+  uint8_t n = 0;
+  uint32_t magnitude = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;
+  do {
+    digits[n++] = '0' + magnitude % 10;
+    magnitude /= 10;
+  } while (magnitude);
+  if (value < 0) put('-');
+  while (n) put(digits[--n]);
+  return *this;
+}
+
+EventWriter& EventWriter::addBool(const char* key, bool value) {
+  putKey(key);
+  putRaw(value ? "true" : "false");
+  return *this;
+}
+
+EventWriter& EventWriter::addString(const char* key, const char* value) {
+  putKey(key);
+  putQuoted(value);
+  return *this;
+}
+
+size_t EventWriter::finish() {
+  putRaw("}]");
+  if (overflow) return 0;
+  buf[len] = '\0';
+  return len;
+}
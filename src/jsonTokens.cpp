@@ -0,0 +1,132 @@
+#include "jsonTokens.hpp"
+#include <string.h>
+
+static int addToken(JsonToken* tokens, uint16_t maxTokens, int& count, JsonType type,
+                    size_t start, size_t end, int parent) {
+  if (count >= maxTokens) return JSON_ERROR_NOMEM;
+  tokens[count] = {type, (uint16_t)start, (uint16_t)end, 0, (int16_t)parent};
+  if (parent >= 0) tokens[parent].size++;
+  return count++;
+}
+
+int jsonTokenize(const char* js, size_t len, JsonToken* tokens, uint16_t maxTokens) {
+  if (len >= UINT16_MAX) return JSON_ERROR_INVAL;
+  int count = 0;
+  int super = -1; // open container, or the key whose value comes next
+
+  for (size_t pos = 0; pos < len; pos++) {
+    char c = js[pos];
+    switch (c) {
+      case '{':
+      case '[': {
+        if (super >= 0 && tokens[super].type == JSON_OBJECT) return JSON_ERROR_INVAL; // keys are strings
+        // end stays 0 until the container closes
+        int t = addToken(tokens, maxTokens, count, c == '{' ? JSON_OBJECT : JSON_ARRAY, pos, 0, super);
+        if (t < 0) return t;
+        super = t;
+        break;
+      }
+
+      case '}':
+      case ']': {
+        JsonType type = c == '}' ? JSON_OBJECT : JSON_ARRAY;
+        int t = count - 1;
+        while (t >= 0 && !((tokens[t].type == JSON_OBJECT || tokens[t].type == JSON_ARRAY) && tokens[t].end == 0))
+          t = tokens[t].parent;
+        if (t < 0 || tokens[t].type != type) return JSON_ERROR_INVAL;
+        tokens[t].end = pos + 1;
+        super = tokens[t].parent;
+        break;
+      }
+
+      case '"': {
+        size_t start = pos + 1;
+        for (pos = start; pos < len && js[pos] != '"'; pos++) {
+          if (js[pos] == '\\') pos++; // escaped quote or backslash; \uXXXX is plain hex after it
+        }
+        if (pos >= len) return JSON_ERROR_PART;
+        int t = addToken(tokens, maxTokens, count, JSON_STRING, start, pos, super);
+        if (t < 0) return t;
+        break;
+      }
+
+      case ':':
+        if (count == 0 || tokens[count - 1].type != JSON_STRING) return JSON_ERROR_INVAL;
+        super = count - 1;
+        break;
+
+      case ',':
+        if (super >= 0 && tokens[super].type != JSON_OBJECT && tokens[super].type != JSON_ARRAY)
+          super = tokens[super].parent;
+        break;
+
+      case ' ': case '\t': case '\r': case '\n':
+        break;
+
+      default: {
+        if (super >= 0 && tokens[super].type == JSON_OBJECT) return JSON_ERROR_INVAL;
+        size_t start = pos;
+        while (pos < len && !strchr(" \t\r\n,]}:", js[pos])) {
+          if ((uint8_t)js[pos] < 0x20 || js[pos] == '"' || js[pos] == '{' || js[pos] == '[') return JSON_ERROR_INVAL;
+          pos++;
+        }
+        int t = addToken(tokens, maxTokens, count, JSON_PRIMITIVE, start, pos, super);
+        if (t < 0) return t;
+        pos--; // the delimiter is handled by the next pass
+        break;
+      }
+    }
+  }
+
+  for (int t = 0; t < count; t++) {
+    if ((tokens[t].type == JSON_OBJECT || tokens[t].type == JSON_ARRAY) && tokens[t].end == 0)
+      return JSON_ERROR_PART;
+  }
+  return count;
+}
+
+int JsonDoc::next(int i) const {
+  if (!valid(i)) return count;
+  int j = i + 1;
+  while (j < count && tokens[j].start < tokens[i].end) j++;
+  return j;
+}
+
+int JsonDoc::get(int object, const char* key) const {
+  if (!isObject(object)) return -1;
+  int k = object + 1;
+  for (int n = 0; n < tokens[object].size && k + 1 < count; n++) {
+    if (equals(k, key)) return k + 1;
+    k = next(k + 1);
+  }
+  return -1;
+}
+
+int JsonDoc::item(int array, int n) const {
+  if (!isArray(array) || n < 0 || n >= tokens[array].size) return -1;
+  int k = array + 1;
+  while (n-- > 0) k = next(k);
+  return valid(k) ? k : -1;
+}
+
+bool JsonDoc::equals(int i, const char* s) const {
+  size_t len = strlen(s);
+  return isString(i) && (size_t)length(i) == len && memcmp(text(i), s, len) == 0;
+}
+
+bool JsonDoc::getInt(int i, int32_t& value) const {
+  if (!valid(i) || tokens[i].type != JSON_PRIMITIVE) return false;
+  const char* p = text(i);
+  const char* end = p + length(i);
+  bool negative = p < end && *p == '-';
+  if (negative) p++;
+  if (p >= end || *p < '0' || *p > '9') return false;
+  int64_t magnitude = 0;
+  for (; p < end && *p >= '0' && *p <= '9'; p++) {
+    magnitude = magnitude * 10 + (*p - '0');
+    if (magnitude > INT32_MAX) magnitude = (int64_t)INT32_MAX + 1;
+  }
+  if (negative) magnitude = -magnitude;
+  value = magnitude < INT32_MIN ? INT32_MIN : (magnitude > INT32_MAX ? INT32_MAX : (int32_t)magnitude);
+  return true;
+}
@@ -7,28 +7,67 @@
 #include "setup.hpp"
 #include "socketIO.hpp"
 #include "encoder.hpp"
+#include "pcntEncoder.hpp"
 #include "calibration.hpp"
+#include "motion.hpp"
+#include "posJournal.hpp"
 
-// Global encoder instances
-Encoder* topEnc = new Encoder(ENCODER_PIN_A, ENCODER_PIN_B);
-Encoder* bottomEnc = new Encoder(InputEnc_PIN_A, InputEnc_PIN_B);
-
-// Global encoder pointers (used by servo.cpp)
-
-// Global calibration instance
-Calibration calib;
+// Port wiring. Each port owns its motor (top) and wand (bottom) encoders.
+#if topEncPCNT
+#define newMotorEncoder() new PcntEncoder(ENCODER_PIN_A, ENCODER_PIN_B)
+#else
+#define newMotorEncoder() new PinnedEncoder<ENCODER_PIN_A, ENCODER_PIN_B>()
+#endif
+BlindPort ports[NUM_PORTS] = {
+  {{1, servoPin, servoSwitch, servoLEDCChannel, nvsCalib, nvsServo},
+   newMotorEncoder(), new PinnedEncoder<InputEnc_PIN_A, InputEnc_PIN_B>()},
+};
 
 void switchOnOffServo() {
   while (1) {
     printf("Servo On\n");
-    servoOn(CCW, manual);
+    ports[0].servoOn(CCW, manual);
     vTaskDelay(pdMS_TO_TICKS(2000));
     printf("Servo Off\n");
-    servoOff();
+    ports[0].servoOff();
     vTaskDelay(pdMS_TO_TICKS(2000));
   }
 }
 
+// Save and report positions and calibration results. Runs in its own task so
+// none of this stops while the main loop is reconnecting.
+static void portTask(void* arg) {
+  uint32_t loopCount = 0;
+  while (1) {
+    // calibration results the motion task queued for the server
+    motionSendResults();
+
+    for (BlindPort& port : ports) {
+      if (port.clearCalibFlag) {
+        port.calib.clearCalibrated();
+        emitCalibStatus(false, port.cfg.num);
+        port.clearCalibFlag = false;
+      }
+      if (port.savePosFlag) {
+        MotionState saved = port.servoSavePos();
+        port.savePosFlag = false;
+
+        // Send position update to server; if it only got queued, device_init
+        // must not move the blind back to the server's older position
+        if (emitPosHit(saved.appPos, port.cfg.num))
+          printf("Sent pos_hit: port %d position %d\n", port.cfg.num, saved.appPos);
+        else port.movedOffline = true;
+      }
+    }
+    if (++loopCount % 100 == 0) {
+      motionLogStats();
+      journalLogStats();
+      socketLogStats();
+    }
+    vTaskDelay(pdMS_TO_TICKS(portTaskPeriodMs));
+  }
+}
+
 void mainApp() {
   esp_err_t ret = nvs_flash_init(); // change to secure init logic soon!!
   // 2. If NVS is full or corrupt (common after flashing new code), erase and retry
@@ -39,22 +78,23 @@ void mainApp() {
   ESP_ERROR_CHECK(ret);
 
   bmWiFi.init();
-  calib.init();
+  journalInit();
   
-  // Initialize encoders
-  topEnc->init();
-  bottomEnc->init();
+  // Motion task must exist before encoders start posting detents
+  motionInit();
+
+  // Initialize calibration, encoders and servo of every port
   servoInit();
 
   // switchOnOffServo();
 
+  xTaskCreate(portTask, "ports", portTaskStack, NULL, portTaskPriority, NULL);
+
   setupLoop();
   
   statusResolved = false;
-
-  int32_t prevCount = topEnc->getCount();
   
-  // Main loop
+  // Main loop: connection supervision only
   while (1) {
     // websocket disconnect/reconnect handling
     if (statusResolved) {
@@ -66,29 +106,13 @@ void mainApp() {
       else printf("Reconnected!\n");
       statusResolved = false;
     }
-
-    if (clearCalibFlag) {
-      calib.clearCalibrated();
-      emitCalibStatus(false);
-      clearCalibFlag = false;
-    }
-    if (savePosFlag) {
-      servoSavePos();
-      savePosFlag = false;
-
-      // Send position update to server
-      uint8_t currentAppPos = calib.convertToAppPos(topEnc->getCount());
-      emitPosHit(currentAppPos);
-      
-      printf("Sent pos_hit: position %d\n", currentAppPos);
-    }
     vTaskDelay(pdMS_TO_TICKS(100));
   }
 }
 
 void encoderTest() {
   // Create encoder instance
-  Encoder encoder(ENCODER_PIN_A, ENCODER_PIN_B);
+  PinnedEncoder<ENCODER_PIN_A, ENCODER_PIN_B> encoder;
   encoder.init();
 
   int32_t prevCount = encoder.getCount();
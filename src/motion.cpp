@@ -0,0 +1,300 @@
+#include "motion.hpp"
+#include "encoder.hpp"
+#include "servo.hpp"
+#include "defines.h"
+#include "esp_timer.h"
+#include "esp_cpu.h"
+#include "esp_rom_sys.h"
+#include "freertos/queue.h"
+#include "socketIO.hpp"
+#include "posJournal.hpp"
+
+EventRing<EncoderEvent, 64> encoderEvents;
+std::atomic<uint32_t> listenerMaxCycles{0};
+std::atomic<uint32_t> movesCoalesced{0};
+std::atomic<uint32_t> commandsDropped{0};
+std::atomic<uint32_t> resultsDropped{0};
+
+static TaskHandle_t motionTaskHandle = NULL;
+static QueueHandle_t motionQueue = NULL;
+static QueueHandle_t resultQueue = NULL;
+
+// Calibration stage waiting for the servo to settle, per port
+static bool calibPending[NUM_PORTS] = {};
+static MotionCommand calibCmd[NUM_PORTS];
+static int64_t calibDueUs[NUM_PORTS] = {};
+
+// Latest valid move per port, held until that port's next control tick
+static bool movePending[NUM_PORTS] = {};
+static uint16_t moveTarget[NUM_PORTS];
+
+// Push a detent record and wake the motion task. Called from the encoder ISR.
+void IRAM_ATTR motionPostFromISR(uint8_t id, int32_t count) {
+  EncoderEvent ev = {id, count, (uint32_t)esp_timer_get_time()};
+  if (!encoderEvents.push(ev) || motionTaskHandle == NULL) return;
+
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(motionTaskHandle, &woken);
+  portYIELD_FROM_ISR(woken);
+}
+
+// Runs the per-detent control logic that used to live in the encoder ISR.
+// Only the port that owns the encoder is touched.
+static void dispatchEvent(Encoder* encoder) {
+  if (encoder == nullptr || encoder->port == nullptr) return;
+  BlindPort* port = encoder->port;
+
+  port->servoPublishState();
+  if (port->calibListen) port->servoCalibListen();
+  if (encoder == port->topEnc && port->stallWatch) debugLEDTgl();
+  if (encoder->wandListen) port->servoWandListen();
+  if (encoder->serverListen) port->servoServerListen();
+  if (encoder == port->topEnc) port->servoSnapshot();
+}
+
+void motionWake() {
+  if (motionTaskHandle != NULL) xTaskNotifyGive(motionTaskHandle);
+}
+
+static bool enqueue(const MotionCommand& cmd) {
+  if (motionQueue == NULL || xQueueSend(motionQueue, &cmd, 0) != pdTRUE) {
+    commandsDropped++;
+    printf("Motion command %d dropped - queue full\n", cmd.type);
+    return false;
+  }
+  motionWake();
+  return true;
+}
+
+bool motionSubmit(MotionCommandType type, uint8_t port, int32_t value) {
+  MotionCommand cmd = {type, port, {value}};
+  return enqueue(cmd);
+}
+
+bool motionSubmitCurve(uint8_t port, const uint16_t* knots) {
+  MotionCommand cmd = {MOTION_CURVE, port, {0}};
+  memcpy(cmd.knots, knots, sizeof(cmd.knots));
+  return enqueue(cmd);
+}
+
+void motionReport(MotionResultType type, uint8_t port, const char* text, int32_t value) {
+  MotionResult result = {type, port, value, text};
+  if (resultQueue == NULL || xQueueSend(resultQueue, &result, 0) != pdTRUE) {
+    resultsDropped++;
+    printf("Motion result %d dropped - queue full\n", type);
+  }
+}
+
+void motionSendResults() {
+  MotionResult result;
+  while (resultQueue != NULL && xQueueReceive(resultQueue, &result, 0) == pdTRUE) {
+    switch (result.type) {
+      case RESULT_CALIB_STAGE1_READY: emitCalibStage1Ready(result.port); break;
+      case RESULT_CALIB_STAGE2_READY: emitCalibStage2Ready(result.port); break;
+      case RESULT_CALIB_DONE: emitCalibDone(result.port); break;
+      case RESULT_CALIB_ERROR: emitCalibError(result.text, result.port); break;
+      case RESULT_CALIB_PROGRESS: emitCalibProgress(result.text, result.value, result.port); break;
+    }
+  }
+}
+
+static void applyMove(uint8_t idx) {
+  if (!movePending[idx]) return;
+  movePending[idx] = false;
+  ports[idx].runToAppPos(moveTarget[idx]);
+}
+
+static void runCommand(const MotionCommand& cmd) {
+  BlindPort* port = getPort(cmd.port);
+  if (port == nullptr) {
+    printf("Motion command %d for unknown port %d\n", cmd.type, cmd.port);
+    return;
+  }
+  uint8_t idx = port - ports;
+  // anything else for this port runs after the move queued before it
+  if (cmd.type != MOTION_MOVE) applyMove(idx);
+
+  switch (cmd.type) {
+    case MOTION_MOVE:
+      // only a move that can run replaces the one waiting
+      if (!port->calib.getCalibrated()) {
+        printf("Move for port %d ignored - not calibrated\n", cmd.port);
+        break;
+      }
+      if (movePending[idx]) movesCoalesced++;
+      moveTarget[idx] = cmd.value < 0 ? 0 : (cmd.value > posResolution ? posResolution : cmd.value);
+      movePending[idx] = true;
+      break;
+
+    case MOTION_CANCEL:
+      calibPending[idx] = false;
+      port->servoCancelCalib();
+      break;
+
+    case MOTION_CALIB_START:
+      calibPending[idx] = false;
+      if (!port->servoInitCalib()) {
+        printf("initCalib returned False\n");
+        motionReport(RESULT_CALIB_ERROR, cmd.port, "Initialization failed");
+      }
+      else {
+        printf("Ready to calibrate\n");
+        motionReport(RESULT_CALIB_STAGE1_READY, cmd.port);
+      }
+      break;
+
+    case MOTION_CALIB_AUTO:
+      calibPending[idx] = false;
+      if (!port->servoAutoCalibStart()) motionReport(RESULT_CALIB_ERROR, cmd.port, "Initialization failed");
+      break;
+
+    case MOTION_CALIB_STAGE1:
+    case MOTION_CALIB_STAGE2:
+      // let the servo settle without blocking the task, then record the stage
+      port->servoPauseCalib();
+      calibCmd[idx] = cmd;
+      calibPending[idx] = true;
+      calibDueUs[idx] = esp_timer_get_time() + calibSettleMs * 1000;
+      break;
+
+    case MOTION_CURVE:
+      // the map is only rebuilt here, where moves and published positions read it
+      if (port->calib.saveCurve(cmd.knots)) {
+        printf("Position curve updated for port %d\n", cmd.port);
+        port->servoPublishState();
+      }
+      break;
+  }
+}
+
+static void finishCalibStage(BlindPort& port, const MotionCommand& cmd) {
+  if (cmd.type == MOTION_CALIB_STAGE1) {
+    if (!port.servoBeginDownwardCalib()) motionReport(RESULT_CALIB_ERROR, cmd.port, "Direction Switch Failed");
+    else motionReport(RESULT_CALIB_STAGE2_READY, cmd.port);
+  }
+  else {
+    if (!port.servoCompleteCalib()) motionReport(RESULT_CALIB_ERROR, cmd.port, "Completion failed");
+    else motionReport(RESULT_CALIB_DONE, cmd.port);
+  }
+}
+
+// True while some port needs control-period updates
+static bool anyPortBusy() {
+  for (BlindPort& port : ports)
+    if (port.servoProfileActive() || port.servoAutoCalibActive()) return true;
+  return false;
+}
+
+static void motionTask(void* arg) {
+  EncoderEvent ev;
+  MotionCommand cmd;
+  int64_t lastControlUs[NUM_PORTS] = {};
+  while (1) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(anyPortBusy() ? controlPeriodMs : motionPollMs));
+    // Moves only replace the port's waiting target here; the control tick
+    // below applies it, so a burst of moves costs one retarget.
+    for (uint8_t n = 0; n < motionQueueLen && xQueueReceive(motionQueue, &cmd, 0) == pdTRUE; n++)
+      runCommand(cmd);
+    for (uint8_t i = 0; i < NUM_PORTS; i++) {
+      if (calibPending[i] && esp_timer_get_time() >= calibDueUs[i]) {
+        calibPending[i] = false;
+        finishCalibStage(ports[i], calibCmd[i]);
+      }
+    }
+
+    while (encoderEvents.pop(ev)) {
+      uint32_t startCycles = esp_cpu_get_cycle_count();
+      Encoder* encoder = Encoder::fromId(ev.id);
+      if (encoder != nullptr) encoder->recordEdge(ev.count, ev.timeUs);
+      dispatchEvent(encoder);
+      uint32_t elapsed = esp_cpu_get_cycle_count() - startCycles;
+      if (elapsed > listenerMaxCycles) listenerMaxCycles = elapsed;
+    }
+
+    // Backends that only interrupt on watch points are sampled here,
+    // which keeps the last-edge timestamp fresh for stall detection.
+    int32_t count;
+    for (uint8_t i = 0; i < MAX_ENCODERS; i++) {
+      Encoder* encoder = Encoder::fromId(i);
+      if (encoder != nullptr && encoder->poll(count)) {
+        encoder->recordEdge(count, (uint32_t)esp_timer_get_time());
+        dispatchEvent(encoder);
+      }
+    }
+
+    for (uint8_t i = 0; i < NUM_PORTS; i++) {
+      BlindPort& port = ports[i];
+      port.servoStallCheck();
+      port.servoCoastCheck();
+      port.servoAutoCalibTick();
+      port.servoRampCheck();
+
+      // Speed profile runs at a fixed period regardless of how often detents wake us.
+      // A waiting move starts an idle port at once and retargets a running one on its tick.
+      int64_t now = esp_timer_get_time();
+      if (!port.servoProfileActive() || lastControlUs[i] == 0 || now - lastControlUs[i] >= controlPeriodMs * 1000)
+        applyMove(i);
+      if (!port.servoProfileActive()) lastControlUs[i] = 0;
+      else if (lastControlUs[i] == 0) {
+        port.servoProfileTick(controlPeriodMs / 1000.0f);
+        lastControlUs[i] = now;
+      }
+      else if (now - lastControlUs[i] >= controlPeriodMs * 1000) {
+        port.servoProfileTick((now - lastControlUs[i]) / 1000000.0f);
+        lastControlUs[i] = now;
+      }
+    }
+
+    // Flash writes stall the CPU, so settled positions go out only while nothing moves
+    if (!anyPortBusy()) journalFlush();
+  }
+}
+
+void motionInit() {
+  if (motionTaskHandle != NULL) return;
+  motionQueue = xQueueCreate(motionQueueLen, sizeof(MotionCommand));
+  resultQueue = xQueueCreate(motionResultLen, sizeof(MotionResult));
+  xTaskCreate(motionTask, "motion", motionTaskStack, NULL, motionTaskPriority, &motionTaskHandle);
+}
+
+void motionLogStats() {
+  static uint32_t lastIsrMax = 0;
+  static uint32_t lastListenerMax = 0;
+  static uint32_t lastCoalesced = 0;
+  static uint32_t lastDropped = 0;
+  static uint32_t lastResultsDropped = 0;
+  static uint32_t lastErrors = 0;
+  uint32_t isrMax = Encoder::isrMaxCycles;
+  uint32_t listenerMax = listenerMaxCycles;
+  uint32_t coalesced = movesCoalesced;
+  uint32_t dropped = commandsDropped;
+  uint32_t lostResults = resultsDropped;
+
+  // illegal double transitions, per encoder by pins
+  char errorText[24 * MAX_ENCODERS] = "";
+  size_t len = 0;
+  uint32_t errors = 0;
+  for (uint8_t id = 0; id < MAX_ENCODERS; id++) {
+    Encoder* encoder = Encoder::fromId(id);
+    if (encoder == nullptr) continue;
+    uint32_t n = encoder->getErrors();
+    errors += n;
+    if (len < sizeof(errorText))
+      len += snprintf(errorText + len, sizeof(errorText) - len, " %d/%d: %lu", encoder->pin_a, encoder->pin_b, n);
+  }
+
+  if (isrMax == lastIsrMax && listenerMax == lastListenerMax && coalesced == lastCoalesced
+      && dropped == lastDropped && lostResults == lastResultsDropped && errors == lastErrors) return;
+  lastIsrMax = isrMax;
+  lastListenerMax = listenerMax;
+  lastCoalesced = coalesced;
+  lastDropped = dropped;
+  lastResultsDropped = lostResults;
+  lastErrors = errors;
+
+  uint32_t cyclesPerUs = esp_rom_get_cpu_ticks_per_us();
+  printf("Encoder ISR worst case: %lu cycles (%lu us), decode errors:%s\n", isrMax, isrMax / cyclesPerUs, errorText);
+  printf("Deferred listeners worst case: %lu cycles (%lu us), ring overflows: %lu\n",
+         listenerMax, listenerMax / cyclesPerUs, encoderEvents.overflows.load());
+  printf("Motion commands: %lu moves coalesced, %lu dropped, %lu results dropped\n", coalesced, dropped, lostResults);
+}
@@ -0,0 +1,71 @@
+#include "motionChecks.hpp"
+#include "defines.h"
+#include <stdlib.h>
+#include <sys/param.h>
+
+void StallMonitor::start(int64_t nowUs, uint32_t lastEdgeUs) {
+  running = true;
+  startUs = nowUs;
+  startEdgeUs = lastEdgeUs;
+}
+
+bool StallMonitor::stalled(int64_t nowUs, uint32_t lastEdgeUs, uint32_t periodUs, float commandedVel, uint32_t& sinceUs) const {
+  if (!running) return false;
+  // measure from the later of the last detent and the start of this run
+  bool edgeThisRun = lastEdgeUs != startEdgeUs;
+  sinceUs = edgeThisRun ? (uint32_t)nowUs - lastEdgeUs : (uint32_t)(nowUs - startUs);
+  return sinceUs >= thresholdUs(edgeThisRun, periodUs, commandedVel);
+}
+
+uint32_t StallMonitor::thresholdUs(bool edgeThisRun, uint32_t periodUs, float commandedVel) {
+  // spin-up allowance, also while the detent period is still unknown
+  if (!edgeThisRun || (periodUs == 0 && commandedVel <= profileSettleVel)) return stallMaxMs * 1000;
+  if (commandedVel > profileSettleVel) periodUs = MAX(periodUs, (uint32_t)(1000000 / commandedVel));
+  uint32_t limitUs = stallEdgePeriods * periodUs;
+  return MIN(MAX(limitUs, (uint32_t)stallMinMs * 1000), (uint32_t)stallMaxMs * 1000);
+}
+
+SeekResult EndStopSeeker::update(int64_t nowUs, float speed) {
+  int64_t elapsedMs = (nowUs - startUs) / 1000;
+  if (speed > peakVel) peakVel = speed;
+  if (elapsedMs > autoCalibTimeoutMs) return SEEK_TIMEOUT;
+  if (elapsedMs < autoCalibSpinUpMs) return SEEK_RUNNING;
+  // checked before the collapse, which a motor that never moved always passes
+  if (peakVel < profileSettleVel) return SEEK_NO_MOTION;
+  return speed < peakVel * autoCalibCollapse ? SEEK_FOUND : SEEK_RUNNING;
+}
+
+float sweepFeedForward(float peakUp, float peakDown) {
+  if (peakUp < profileSettleVel || peakDown < profileSettleVel) return 0;
+  float kf = autoCalibDuty * 2 / (peakUp + peakDown);
+  if (kf < defaultKf / kfTuneRange || kf > defaultKf * kfTuneRange) return 0;
+  return kf;
+}
+
+void WandFollow::observe(int32_t error) {
+  if (!active) return;
+  stats.maxLag = MAX(stats.maxLag, abs(error));
+  stats.overshoot = MAX(stats.overshoot, -dir * error);
+}
+
+int32_t WandFollow::duty(int32_t error, int32_t wandVel, float kf, bool running) const {
+  int8_t d;
+  if (error > followDeadband) d = 1;
+  else if (error < -followDeadband) d = -1;
+  else if (running && dir * error >= 0 && dir * wandVel > followHoldVel * 1000) d = dir;
+  else return 0;
+
+  float u = followKp * error + kf * wandVel / 1000.0f;
+  // never drive away from the wand, and keep enough drive to turn the servo
+  float maxDuty = d > 0 ? ccwSpeed - offSpeed : offSpeed - cwSpeed;
+  return d * (int32_t)MIN(MAX(d * u, (float)followMinDuty), maxDuty);
+}
+
+void WandFollow::drive(int32_t error, int32_t duty, bool fromRest, int64_t nowUs, int32_t motorCount) {
+  dir = duty > 0 ? 1 : -1;
+  if (!active) {
+    active = true;
+    stats = {nowUs, motorCount, abs(error), 0, 0};
+  }
+  if (fromRest) stats.starts++;
+}
@@ -0,0 +1,157 @@
+#include "pcntEncoder.hpp"
+#include "esp_log.h"
+#include "motion.hpp"
+#include "defines.h"
+
+static const char *TAG = "PCNT_ENCODER";
+
+// Hardware counter window in quarter steps. Multiples of 4 keep the
+// detent phase intact when the counter wraps back to zero at a limit.
+#define pcntHighLimit 32000
+#define pcntLowLimit -32000
+
+PcntEncoder::PcntEncoder(gpio_num_t pinA, gpio_num_t pinB)
+    : Encoder(pinA, pinB), unit(nullptr), chan_a(nullptr), chan_b(nullptr),
+      rawBase(0), offset(0), watchRaw(0), lastPolled(0) {}
+
+// Same detent hysteresis as GpioEncoder: up at +4 quarter steps, down at -1.
+int32_t IRAM_ATTR PcntEncoder::countFromRaw(int32_t raw) const {
+  return offset + (raw >= 0 ? raw / 4 : (raw - 3) / 4);
+}
+
+// Watch point ISR - accumulates limit wraps and posts the crossing to the motion task
+bool IRAM_ATTR PcntEncoder::on_reach(pcnt_unit_handle_t unit, const pcnt_watch_event_data_t* edata, void* user_ctx) {
+  PcntEncoder* encoder = static_cast<PcntEncoder*>(user_ctx);
+  int value = edata->watch_point_value;
+  int32_t raw;
+  if (value == pcntHighLimit || value == pcntLowLimit) {
+    // hardware counter has already been reset to zero
+    raw = encoder->rawBase.fetch_add(value) + value;
+  }
+  else raw = encoder->rawBase + value;
+
+  motionPostFromISR(encoder->id, encoder->countFromRaw(raw));
+  return false;
+}
+
+void PcntEncoder::init() {
+  if (!registerInstance() || unit != nullptr) return;
+
+  pcnt_unit_config_t unit_config = {};
+  unit_config.low_limit = pcntLowLimit;
+  unit_config.high_limit = pcntHighLimit;
+  // Same level as the GPIO bank ISR: both push to encoderEvents and must not preempt each other
+  unit_config.intr_priority = 1;
+  ESP_ERROR_CHECK(pcnt_new_unit(&unit_config, &unit));
+
+  pcnt_glitch_filter_config_t filter_config = {};
+  filter_config.max_glitch_ns = pcntGlitchNs;
+  ESP_ERROR_CHECK(pcnt_unit_set_glitch_filter(unit, &filter_config));
+
+  // Full x4 quadrature decode, same direction convention as quadTable
+  pcnt_chan_config_t chan_a_config = {};
+  chan_a_config.edge_gpio_num = pin_a;
+  chan_a_config.level_gpio_num = pin_b;
+  ESP_ERROR_CHECK(pcnt_new_channel(unit, &chan_a_config, &chan_a));
+  pcnt_chan_config_t chan_b_config = {};
+  chan_b_config.edge_gpio_num = pin_b;
+  chan_b_config.level_gpio_num = pin_a;
+  ESP_ERROR_CHECK(pcnt_new_channel(unit, &chan_b_config, &chan_b));
+
+  ESP_ERROR_CHECK(pcnt_channel_set_edge_action(chan_a, PCNT_CHANNEL_EDGE_ACTION_DECREASE, PCNT_CHANNEL_EDGE_ACTION_INCREASE));
+  ESP_ERROR_CHECK(pcnt_channel_set_level_action(chan_a, PCNT_CHANNEL_LEVEL_ACTION_KEEP, PCNT_CHANNEL_LEVEL_ACTION_INVERSE));
+  ESP_ERROR_CHECK(pcnt_channel_set_edge_action(chan_b, PCNT_CHANNEL_EDGE_ACTION_INCREASE, PCNT_CHANNEL_EDGE_ACTION_DECREASE));
+  ESP_ERROR_CHECK(pcnt_channel_set_level_action(chan_b, PCNT_CHANNEL_LEVEL_ACTION_KEEP, PCNT_CHANNEL_LEVEL_ACTION_INVERSE));
+
+  // Same pull-ups as the GPIO backend
+  gpio_set_pull_mode(pin_a, GPIO_PULLUP_ONLY);
+  gpio_set_pull_mode(pin_b, GPIO_PULLUP_ONLY);
+
+  // Limits must be watch points so wraps get accumulated into rawBase
+  ESP_ERROR_CHECK(pcnt_unit_add_watch_point(unit, pcntHighLimit));
+  ESP_ERROR_CHECK(pcnt_unit_add_watch_point(unit, pcntLowLimit));
+  pcnt_event_callbacks_t cbs = {};
+  cbs.on_reach = PcntEncoder::on_reach;
+  ESP_ERROR_CHECK(pcnt_unit_register_event_callbacks(unit, &cbs, this));
+
+  ESP_ERROR_CHECK(pcnt_unit_enable(unit));
+  ESP_ERROR_CHECK(pcnt_unit_clear_count(unit));
+  ESP_ERROR_CHECK(pcnt_unit_start(unit));
+
+  ESP_LOGI(TAG, "PCNT encoder initialized on pins %d and %d", pin_a, pin_b);
+}
+
+void PcntEncoder::deinit() {
+  if (unit == nullptr) return;
+  // keep the position once the hardware is released
+  offset = getCount();
+  rawBase = 0;
+
+  pcnt_unit_stop(unit);
+  pcnt_unit_disable(unit);
+  if (watchRaw != 0) pcnt_unit_remove_watch_point(unit, watchRaw);
+  watchRaw = 0;
+  pcnt_unit_remove_watch_point(unit, pcntHighLimit);
+  pcnt_unit_remove_watch_point(unit, pcntLowLimit);
+  pcnt_del_channel(chan_a);
+  pcnt_del_channel(chan_b);
+  pcnt_del_unit(unit);
+  chan_a = chan_b = nullptr;
+  unit = nullptr;
+  ESP_LOGI(TAG, "PCNT encoder deinitialized");
+}
+
+int32_t PcntEncoder::getCount() const {
+  if (unit == nullptr) return offset;
+  int32_t base;
+  int hw = 0;
+  // retry if a limit wrap was accumulated while reading
+  do {
+    base = rawBase;
+    pcnt_unit_get_count(unit, &hw);
+  } while (base != rawBase);
+  return countFromRaw(base + hw);
+}
+
+void PcntEncoder::setCount(int32_t value) {
+  if (unit != nullptr) {
+    if (watchRaw != 0) pcnt_unit_remove_watch_point(unit, watchRaw);
+    watchRaw = 0;
+    pcnt_unit_clear_count(unit);
+  }
+  rawBase = 0;
+  offset = value;
+  lastPolled = value;
+}
+
+void PcntEncoder::setWatch(int32_t value) {
+  if (unit == nullptr) return;
+  if (watchRaw != 0) {
+    pcnt_unit_remove_watch_point(unit, watchRaw);
+    watchRaw = 0;
+  }
+
+  int32_t current = getCount();
+  if (value == current) return;
+
+  // A detent is reached at its first quarter step going up, its last going down
+  int32_t raw = (value - offset) * 4 + (value < current ? 3 : 0);
+  int hwTarget = raw - rawBase;
+
+  // Outside the current hardware window: the limit wrap re-runs the listeners, which re-arm
+  if (hwTarget == 0 || hwTarget <= pcntLowLimit || hwTarget >= pcntHighLimit) return;
+  if (pcnt_unit_add_watch_point(unit, hwTarget) == ESP_OK) watchRaw = hwTarget;
+  else ESP_LOGW(TAG, "Failed to arm watch point at %d", value);
+}
+
+bool PcntEncoder::poll(int32_t& value) {
+  if (unit == nullptr) return false;
+  value = getCount();
+  if (value == lastPolled) return false;
+  lastPolled = value;
+  return true;
+}
+
+PcntEncoder::~PcntEncoder() {
+  deinit();
+}
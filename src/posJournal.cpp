@@ -0,0 +1,204 @@
+#include "posJournal.hpp"
+#include <stdio.h>
+#include <stddef.h>
+#include "esp_partition.h"
+#include "esp_timer.h"
+#include "esp_rom_crc.h"
+#include "freertos/FreeRTOS.h"
+#include "defines.h"
+
+#define JOURNAL_MAGIC 0x4A50 // "PJ"
+#define JOURNAL_SECTOR 4096
+
+struct JournalRecord {
+  uint16_t magic;
+  uint8_t port;
+  uint8_t reserved;
+  uint32_t seq;
+  int32_t pos;
+  uint32_t crc; // over everything above
+};
+static_assert(JOURNAL_SECTOR % sizeof(JournalRecord) == 0, "records must not straddle sectors");
+
+// Latest known and pending position of one port
+struct JournalSlot {
+  uint8_t port;       // 0 = unused
+  bool stored;        // written holds a value that is in flash
+  int32_t written;
+  bool pending;
+  int32_t pendingPos;
+  int64_t changedUs;  // when pendingPos last changed
+};
+
+std::atomic<uint32_t> journalWrites{0};
+std::atomic<uint32_t> journalWritesSaved{0};
+std::atomic<uint32_t> journalErases{0};
+
+static const esp_partition_t* journalPart = NULL;
+static uint32_t writeOffset = 0;
+static uint32_t nextSeq = 1;
+static JournalSlot slots[NUM_PORTS] = {};
+static portMUX_TYPE journalLock = portMUX_INITIALIZER_UNLOCKED;
+
+static uint32_t recordCrc(const JournalRecord& rec) {
+  return esp_rom_crc32_le(0, (const uint8_t*)&rec, offsetof(JournalRecord, crc));
+}
+
+static bool recordBlank(const JournalRecord& rec) {
+  const uint8_t* bytes = (const uint8_t*)&rec;
+  for (size_t i = 0; i < sizeof(rec); i++)
+    if (bytes[i] != 0xFF) return false;
+  return true;
+}
+
+static JournalSlot* findSlot(uint8_t port, bool create) {
+  for (JournalSlot& slot : slots) {
+    if (slot.port == port) return &slot;
+  }
+  if (!create) return nullptr;
+  for (JournalSlot& slot : slots) {
+    if (slot.port == 0) {
+      slot.port = port;
+      return &slot;
+    }
+  }
+  return nullptr;
+}
+
+bool journalInit() {
+  journalPart = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                         (esp_partition_subtype_t)posJournalSubtype, posJournalLabel);
+  if (journalPart == NULL) {
+    printf("Position journal partition missing - falling back to NVS\n");
+    return false;
+  }
+
+  // Newest valid record per port, and the newest overall to resume after
+  uint32_t newestSeq = 0;
+  uint32_t newestOffset = 0;
+  uint32_t newestPortSeq[NUM_PORTS] = {};
+  JournalRecord rec;
+  for (uint32_t off = 0; off < journalPart->size; off += sizeof(rec)) {
+    if (esp_partition_read(journalPart, off, &rec, sizeof(rec)) != ESP_OK) break;
+    if (rec.magic != JOURNAL_MAGIC || rec.crc != recordCrc(rec) || rec.port == 0) continue;
+    if (rec.seq >= newestSeq) {
+      newestSeq = rec.seq;
+      newestOffset = off;
+    }
+    JournalSlot* slot = findSlot(rec.port, true);
+    if (slot == nullptr) continue;
+    uint32_t& portSeq = newestPortSeq[slot - slots];
+    if (rec.seq >= portSeq) {
+      portSeq = rec.seq;
+      slot->written = rec.pos;
+      slot->stored = true;
+    }
+  }
+
+  if (newestSeq == 0) {
+    writeOffset = 0;
+    printf("Position journal empty\n");
+  }
+  else {
+    nextSeq = newestSeq + 1;
+    writeOffset = (newestOffset + sizeof(rec)) % journalPart->size;
+    // A torn write after the newest record leaves a non-blank slot; resume in the next sector
+    while (writeOffset % JOURNAL_SECTOR != 0) {
+      if (esp_partition_read(journalPart, writeOffset, &rec, sizeof(rec)) == ESP_OK && recordBlank(rec)) break;
+      writeOffset = (writeOffset + sizeof(rec)) % journalPart->size;
+    }
+    printf("Position journal recovered, seq %lu\n", newestSeq);
+  }
+  return true;
+}
+
+bool journalRead(uint8_t port, int32_t& pos) {
+  JournalSlot* slot = findSlot(port, false);
+  if (journalPart == NULL || slot == nullptr || !slot->stored) return false;
+  pos = slot->written;
+  return true;
+}
+
+static bool appendRecord(uint8_t port, int32_t pos) {
+  JournalRecord rec = {};
+  rec.magic = JOURNAL_MAGIC;
+  rec.seq = nextSeq++;
+  rec.pos = pos;
+  rec.port = port;
+  rec.crc = recordCrc(rec);
+
+  esp_err_t err = esp_partition_write(journalPart, writeOffset, &rec, sizeof(rec));
+  writeOffset = (writeOffset + sizeof(rec)) % journalPart->size;
+  if (err != ESP_OK) {
+    printf("Position journal write failed: %s\n", esp_err_to_name(err));
+    return false;
+  }
+  journalWrites++;
+  return true;
+}
+
+// Entering a sector erases its oldest records, so every port's latest
+// position is carried forward into the fresh sector first.
+static bool startSector() {
+  esp_err_t err = esp_partition_erase_range(journalPart, writeOffset, JOURNAL_SECTOR);
+  if (err != ESP_OK) {
+    printf("Position journal erase failed: %s\n", esp_err_to_name(err));
+    return false;
+  }
+  journalErases++;
+  for (JournalSlot& slot : slots) {
+    if (slot.port != 0 && slot.stored) appendRecord(slot.port, slot.written);
+  }
+  return true;
+}
+
+bool journalSave(uint8_t port, int32_t pos) {
+  if (journalPart == NULL) return false;
+  portENTER_CRITICAL(&journalLock);
+  JournalSlot* slot = findSlot(port, true);
+  if (slot != nullptr) {
+    if (slot->pending) journalWritesSaved++; // superseded before reaching flash
+    if (!slot->pending || slot->pendingPos != pos) slot->changedUs = esp_timer_get_time();
+    slot->pending = true;
+    slot->pendingPos = pos;
+  }
+  portEXIT_CRITICAL(&journalLock);
+  return slot != nullptr;
+}
+
+// Write positions that have held still for journalSettleMs
+void journalFlush() {
+  if (journalPart == NULL) return;
+  int64_t now = esp_timer_get_time();
+  for (JournalSlot& slot : slots) {
+    portENTER_CRITICAL(&journalLock);
+    bool due = slot.pending && now - slot.changedUs >= journalSettleMs * 1000;
+    int32_t pos = slot.pendingPos;
+    if (due) slot.pending = false;
+    portEXIT_CRITICAL(&journalLock);
+    if (!due) continue;
+
+    if (slot.stored && slot.written == pos) {
+      journalWritesSaved++;
+      continue;
+    }
+    if (writeOffset % JOURNAL_SECTOR == 0 && !startSector()) continue;
+    if (appendRecord(slot.port, pos)) {
+      slot.written = pos;
+      slot.stored = true;
+      printf("Success - Port %d position journaled as: %d\n", slot.port, pos);
+    }
+  }
+}
+
+void journalLogStats() {
+  static uint32_t lastWrites = 0;
+  static uint32_t lastSaved = 0;
+  uint32_t writes = journalWrites;
+  uint32_t saved = journalWritesSaved;
+  if (writes == lastWrites && saved == lastSaved) return;
+  lastWrites = writes;
+  lastSaved = saved;
+  printf("Position journal: %lu flash writes, %lu saved, %lu sector erases\n",
+         writes, saved, journalErases.load());
+}
@@ -0,0 +1,62 @@
+#include "profile.hpp"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "esp_timer.h"
+#include "defines.h"
+
+static float clampf(float v, float lo, float hi) {
+  return (v < lo) ? lo : ((v > hi) ? hi : v);
+}
+
+void MotionProfile::start(int32_t newTarget) {
+  target = newTarget;
+  restart = true;
+  active = true;
+}
+
+bool MotionProfile::update(int32_t pos, float velocity, float dt, const PIDGains& gains, int32_t& duty) {
+  int32_t goal = target;
+  if (restart.exchange(false)) {
+    // new move or mid-flight retarget: continue from the measured speed
+    vRef = velocity;
+    integral = 0;
+    prevError = 0;
+    startUs = esp_timer_get_time();
+    startPos = pos;
+    movingUp = goal > pos;
+  }
+
+  int32_t remaining = goal - pos;
+  if (abs(remaining) <= profileTolerance && fabsf(velocity) < profileSettleVel) {
+    active = false;
+    duty = 0;
+    return false;
+  }
+
+  // Cruise at profileMaxVel, but never faster than we can brake within the remaining distance
+  float vStop = sqrtf(2.0f * profileAccel * abs(remaining));
+  float vGoal = (remaining > 0 ? 1.0f : -1.0f) * fminf(profileMaxVel, vStop);
+  float dv = profileAccel * dt;
+  vRef += clampf(vGoal - vRef, -dv, dv);
+
+  float error = vRef - velocity;
+  float derivative = (error - prevError) / dt;
+  prevError = error;
+
+  const float maxUp = ccwSpeed - offSpeed;
+  const float maxDown = cwSpeed - offSpeed;
+  float u = gains.kf * vRef + gains.kp * error + gains.ki * integral + gains.kd * derivative;
+  // Anti-windup: stop integrating while saturated in the direction of the error
+  if ((u < maxUp || error < 0) && (u > maxDown || error > 0)) integral += error * dt;
+
+  duty = (int32_t)clampf(u, maxDown, maxUp);
+  return true;
+}
+
+void MotionProfile::report(int32_t pos) {
+  int32_t goal = target;
+  int32_t overshoot = movingUp ? pos - goal : goal - pos;
+  printf("Move %d -> %d: %lld ms, overshoot %d ticks\n", startPos, goal,
+         (esp_timer_get_time() - startUs) / 1000, overshoot > 0 ? overshoot : 0);
+}
@@ -0,0 +1,10 @@
+#include "quadrature.hpp"
+#include "esp_attr.h"
+
+const DRAM_ATTR int8_t quadTable[16] = {
+  // cur: 00      01        10        11
+          0,      -1,       1,        QUAD_ERR, // prev 00
+          1,      0,        QUAD_ERR, -1,       // prev 01
+          -1,     QUAD_ERR, 0,        1,        // prev 10
+          QUAD_ERR, 1,      -1,       0         // prev 11
+};
@@ -3,21 +3,55 @@
 #include "defines.h"
 #include <freertos/FreeRTOS.h>
 #include "esp_log.h"
-#include "socketIO.hpp"
 #include "nvs_flash.h"
+#include "profile.hpp"
+#include "motion.hpp"
+#include "esp_timer.h"
+#include "posJournal.hpp"
+#include "esp_attr.h"
+#include "esp_rom_crc.h"
+#include "esp_system.h"
+#include <math.h>
+#include <stddef.h>
 
-std::atomic<bool> calibListen{false};
-std::atomic<int32_t> baseDiff{0};
-std::atomic<int32_t> target{0};
+#define SNAPSHOT_MAGIC 0x52544353UL // "RTCS"
 
-std::atomic<bool> runningManual{false};
-std::atomic<bool> runningServer{false};
-std::atomic<bool> clearCalibFlag{false};
-std::atomic<bool> savePosFlag{false};
-std::atomic<bool> startLess{false};
+// Live motion state mirrored to RTC memory, which keeps its contents across
+// brownout, watchdog and software resets (but not power-on).
+struct RtcSnapshot {
+  uint32_t magic;
+  int32_t count;
+  int32_t target;
+  uint8_t calibrated;
+  uint8_t moving;
+  uint8_t reserved[2];
+  uint32_t crc; // over everything above; a reset mid-update leaves it invalid
+};
+static RTC_NOINIT_ATTR RtcSnapshot rtcSnapshots[NUM_PORTS];
+
+static uint32_t snapshotCrc(const RtcSnapshot& snap) {
+  return esp_rom_crc32_le(0, (const uint8_t*)&snap, offsetof(RtcSnapshot, crc));
+}
+
+// Last chance to refresh the snapshots on esp_restart()
+static void snapshotAllPorts() {
+  for (BlindPort& port : ports) port.servoSnapshot();
+}
+
+BlindPort::BlindPort(const PortConfig& config, Encoder* top, Encoder* bottom)
+    : cfg(config), topEnc(top), bottomEnc(bottom), calib(config.nvsCalibNs) {
+  topEnc->port = this;
+  bottomEnc->port = this;
+}
+
+BlindPort* getPort(int num) {
+  for (BlindPort& port : ports)
+    if (port.cfg.num == num) return &port;
+  return nullptr;
+}
 
 void servoInit() {
-  // LEDC timer configuration (C++ aggregate initialization)
+  // LEDC timer configuration (C++ aggregate initialization), shared by every port
   ledc_timer_config_t ledc_timer = {};
   ledc_timer.speed_mode = LEDC_LOW_SPEED_MODE;
   ledc_timer.timer_num = LEDC_TIMER_0;
@@ -25,51 +59,98 @@ void servoInit() {
   ledc_timer.freq_hz = 50;
   ledc_timer.clk_cfg = LEDC_AUTO_CLK;
   ESP_ERROR_CHECK(ledc_timer_config(&ledc_timer));
+  ESP_ERROR_CHECK(ledc_fade_func_install(0));
+
+  // Configure debug LED pin as output
+  gpio_reset_pin(GPIO_NUM_22);
+  gpio_set_direction(debugLED, GPIO_MODE_OUTPUT);
+  gpio_set_level(debugLED, 0); // Start with LED off
+
+  for (BlindPort& port : ports) port.init();
+  esp_register_shutdown_handler(snapshotAllPorts);
+  debugLEDSwitch(1);
+}
+
+void BlindPort::init() {
+  calib.init();
+  topEnc->init();
+  bottomEnc->init();
 
   // LEDC channel configuration
   ledc_channel_config_t ledc_channel = {};
   ledc_channel.speed_mode = LEDC_LOW_SPEED_MODE;
-  ledc_channel.channel = servoLEDCChannel;
+  ledc_channel.channel = cfg.channel;
   ledc_channel.timer_sel = LEDC_TIMER_0;
   ledc_channel.intr_type = LEDC_INTR_DISABLE;
-  ledc_channel.gpio_num = servoPin;
+  ledc_channel.gpio_num = cfg.servoPin;
   ledc_channel.duty = offSpeed; // Start off
   ledc_channel.hpoint = 0;
   ESP_ERROR_CHECK(ledc_channel_config(&ledc_channel));
 
   // Configure servo power switch pin as output
-  gpio_reset_pin(servoSwitch);
-  gpio_set_direction(servoSwitch, GPIO_MODE_OUTPUT);
-  gpio_set_level(servoSwitch, 0); // Start with servo power off
-
-  // Configure debug LED pin as output
-  gpio_reset_pin(GPIO_NUM_22);
-  gpio_set_direction(debugLED, GPIO_MODE_OUTPUT);
-  gpio_set_level(debugLED, 0); // Start with LED off
+  gpio_reset_pin(cfg.switchPin);
+  gpio_set_direction(cfg.switchPin, GPIO_MODE_OUTPUT);
+  gpio_set_level(cfg.switchPin, 0); // Start with servo power off
 
-  topEnc->count = servoReadPos();
+  int32_t pos;
+  if (!servoRestoreSnapshot(pos)) pos = servoReadPos();
+  topEnc->setCount(pos);
+  servoPublishState();
   if (calib.getCalibrated()) initMainLoop();
-  debugLEDSwitch(1);
 }
 
-void servoOn(uint8_t dir, uint8_t manOrServer) {
+void BlindPort::servoOn(uint8_t dir, uint8_t manOrServer) {
+  if (manOrServer == manual) profile.stop();
+  servoSetSpeed((dir ? ccwSpeed : cwSpeed) - offSpeed, manOrServer, ramp.startMs);
+}
+
+// duty is a signed offset from offSpeed; positive runs CCW
+void BlindPort::servoSetSpeed(int32_t duty, uint8_t manOrServer, uint32_t rampMs) {
+  // a server move is armed before its first profile tick, so this is where the run starts
+  if (!stall.isRunning()) stall.start(esp_timer_get_time(), topEnc->getLastEdgeUs());
+  powerOffUs = 0;
   servoMainSwitch(1);
-  ledc_set_duty(LEDC_LOW_SPEED_MODE, servoLEDCChannel, (dir ? ccwSpeed : cwSpeed));
-  ledc_update_duty(LEDC_LOW_SPEED_MODE, servoLEDCChannel);
+  applyDuty(offSpeed + duty, rampMs);
   runningManual = !manOrServer;
   runningServer = manOrServer;
 }
 
-void servoOff() {
-  ledc_set_duty(LEDC_LOW_SPEED_MODE, servoLEDCChannel, offSpeed);
-  ledc_update_duty(LEDC_LOW_SPEED_MODE, servoLEDCChannel);
+// Ramps down in hardware; power is cut by servoRampCheck() once the ramp ends.
+void BlindPort::servoOff() {
+  profile.stop();
+  stall.stop();
+  applyDuty(offSpeed, ramp.stopMs);
   runningManual = false;
   runningServer = false;
+  powerOffUs = fadeEndUs;
+  servoRampCheck();
+  servoSnapshot();
+}
+
+// Move the LEDC duty to target, faded by hardware over rampMs. A fade still
+// in progress is stopped first, so a reversal starts from the current duty.
+void BlindPort::applyDuty(uint32_t duty, uint32_t rampMs) {
+  int64_t now = esp_timer_get_time();
+  if (now < fadeEndUs) ledc_fade_stop(LEDC_LOW_SPEED_MODE, cfg.channel);
+  if (rampMs == 0 || ledc_get_duty(LEDC_LOW_SPEED_MODE, cfg.channel) == duty) {
+    ledc_set_duty_and_update(LEDC_LOW_SPEED_MODE, cfg.channel, duty, 0);
+    fadeEndUs = now;
+    return;
+  }
+  ledc_set_fade_with_time(LEDC_LOW_SPEED_MODE, cfg.channel, duty, rampMs);
+  ledc_fade_start(LEDC_LOW_SPEED_MODE, cfg.channel, LEDC_FADE_NO_WAIT);
+  fadeEndUs = now + rampMs * 1000;
+}
+
+// Motion task: cut servo power once a stop ramp has finished
+void BlindPort::servoRampCheck() {
+  if (powerOffUs == 0 || esp_timer_get_time() < powerOffUs) return;
+  powerOffUs = 0;
   servoMainSwitch(0);
 }
 
-void servoMainSwitch(uint8_t onOff) {
-  gpio_set_level(servoSwitch, onOff ? 1 : 0);
+void BlindPort::servoMainSwitch(uint8_t onOff) {
+  gpio_set_level(cfg.switchPin, onOff ? 1 : 0);
 }
 
 void debugLEDSwitch(uint8_t onOff) {
@@ -82,31 +163,141 @@ void debugLEDTgl() {
   onOff = !onOff;
 }
 
-bool servoInitCalib() {
-  topEnc->pauseWatchdog();
+bool BlindPort::servoInitCalib() {
+  stallWatch = false;
   // get ready for calibration by clearing all these listeners
   bottomEnc->wandListen.store(false, std::memory_order_release);
   topEnc->wandListen.store(false, std::memory_order_release);
   topEnc->serverListen.store(false, std::memory_order_release);
   if (!calib.clearCalibrated()) return false;
-  if (topEnc == nullptr || bottomEnc == nullptr) {
-    printf("ERROR: CALIBRATION STARTED BEFORE SERVO INITIALIZATION\n");
-    return false;
-  }
+  servoSnapshot();
   baseDiff = bottomEnc->getCount() - topEnc->getCount();
   calibListen = true;
   return true;
 }
 
-void servoCancelCalib() {
+void BlindPort::servoCancelCalib() {
   calibListen = false;
+  autoPhase = AUTO_OFF;
+  servoOff();
+}
+
+// Automatic calibration: drive into each end stop at reduced duty, detect it
+// from the collapse of encoder speed, and record the range a margin inside it.
+bool BlindPort::servoAutoCalibStart() {
   servoOff();
+  if (!servoInitCalib()) return false;
+  calibListen = false; // the sweep drives the motor, not the wand
+  autoCalibDrive(CCW);
+  autoPhase = AUTO_SEEK_UP;
+  motionReport(RESULT_CALIB_PROGRESS, cfg.num, "seek_up", topEnc->getCount());
+  return true;
+}
+
+void BlindPort::autoCalibDrive(uint8_t dir) {
+  profile.stop();
+  servoSetSpeed(dir ? autoCalibDuty : -autoCalibDuty, manual, ramp.startMs);
+  autoPhaseUs = esp_timer_get_time();
+  seek.start(autoPhaseUs);
 }
 
-void servoCalibListen() {
-  int32_t effDiff = (bottomEnc->getCount() - topEnc->getCount()) - baseDiff;
-  if (effDiff > 1) servoOn(CCW, manual);
+void BlindPort::autoCalibFail(const char* reason) {
+  printf("Automatic calibration failed: %s\n", reason);
+  autoPhase = AUTO_OFF;
+  servoOff();
+  motionReport(RESULT_CALIB_ERROR, cfg.num, reason);
+}
+
+// Advance the sweep (motion task, every pass)
+void BlindPort::servoAutoCalibTick() {
+  if (autoPhase == AUTO_OFF) return;
+  int64_t elapsedMs = (esp_timer_get_time() - autoPhaseUs) / 1000;
+  int32_t count = topEnc->getCount();
+  bool up = autoPhase == AUTO_SEEK_UP || autoPhase == AUTO_BACKOFF_UP || autoPhase == AUTO_SETTLE_UP;
+
+  switch (autoPhase) {
+    case AUTO_SEEK_UP:
+    case AUTO_SEEK_DOWN: {
+      float speed = fabsf(topEnc->getVelocity() / 1000.0f);
+      switch (seek.update(esp_timer_get_time(), speed)) {
+        case SEEK_RUNNING:
+          return;
+        case SEEK_TIMEOUT:
+          autoCalibFail("End stop not found");
+          return;
+        case SEEK_NO_MOTION:
+          autoCalibFail("Motor did not move");
+          return;
+        case SEEK_FOUND:
+          break;
+      }
+
+      // speed collapsed: we're against the end stop, get off it before reporting
+      autoEndStop = count;
+      (up ? autoPeakUp : autoPeakDown) = seek.getPeak();
+      autoCalibDrive(up ? CW : CCW);
+      autoPhase = up ? AUTO_BACKOFF_UP : AUTO_BACKOFF_DOWN;
+      printf("Port %d end stop %s at %d (peak %.1f ticks/s)\n", cfg.num, up ? "up" : "down", count, seek.getPeak());
+      motionReport(RESULT_CALIB_PROGRESS, cfg.num, up ? "end_up" : "end_down", count);
+      break;
+    }
+
+    case AUTO_BACKOFF_UP:
+    case AUTO_BACKOFF_DOWN:
+      if (elapsedMs > autoCalibTimeoutMs) {
+        autoCalibFail("Back-off failed");
+        return;
+      }
+      if (up ? count > autoEndStop - autoCalibMargin : count < autoEndStop + autoCalibMargin) return;
+      servoOff();
+      autoPhaseUs = esp_timer_get_time();
+      autoPhase = up ? AUTO_SETTLE_UP : AUTO_SETTLE_DOWN;
+      break;
+
+    case AUTO_SETTLE_UP:
+      if (elapsedMs < coastSettleMs) return;
+      if (!calib.beginDownwardCalib(topEnc->getCount())) {
+        autoCalibFail("Direction Switch Failed");
+        return;
+      }
+      motionReport(RESULT_CALIB_PROGRESS, cfg.num, "up_recorded", calib.UpTicks);
+      autoCalibDrive(CW);
+      autoPhase = AUTO_SEEK_DOWN;
+      break;
+
+    case AUTO_SETTLE_DOWN:
+      if (elapsedMs < coastSettleMs) return;
+      autoPhase = AUTO_OFF;
+      if (!servoCompleteCalib()) {
+        autoCalibFail("Completion failed");
+        return;
+      }
+      printf("Port %d calibrated automatically: %d - %d\n", cfg.num, calib.UpTicks.load(), calib.DownTicks.load());
+      // both sweeps ran at a known duty, so their speeds give this blind's feed-forward gain
+      if (float kf = sweepFeedForward(autoPeakUp, autoPeakDown)) {
+        PIDGains tuned = calib.gains;
+        tuned.kf = kf;
+        if (calib.saveGains(tuned)) printf("Port %d feed-forward gain %.1f duty per tick/s\n", cfg.num, kf);
+      }
+      else printf("Port %d sweep speeds %.1f / %.1f ticks/s out of range, gains kept\n", cfg.num, autoPeakUp, autoPeakDown);
+      motionReport(RESULT_CALIB_DONE, cfg.num);
+      break;
+
+    default:
+      break;
+  }
+}
+
+void BlindPort::servoCalibListen() {
+  MotionState s = state.read();
+  int32_t bottomCount = s.bottomCount;
+  int32_t effDiff = (bottomCount - s.topCount) - baseDiff;
+  if (effDiff > 1) {
+    topEnc->setWatch(bottomCount - baseDiff - 1);
+    servoOn(CCW, manual);
+  }
   else if (effDiff < -1) {
+    topEnc->setWatch(bottomCount - baseDiff + 1);
     servoOn(CW, manual);
   }
   else {
@@ -114,36 +305,54 @@ void servoCalibListen() {
   }
 }
 
-bool servoBeginDownwardCalib() {
+// Stop mirroring the wand so the servo can settle before a stage is recorded.
+void BlindPort::servoPauseCalib() {
   calibListen = false;
   servoOff();
-  vTaskDelay(pdMS_TO_TICKS(1000));
-  if (!calib.beginDownwardCalib(*topEnc)) return false;
+}
+
+// Call calibSettleMs after servoPauseCalib()
+bool BlindPort::servoBeginDownwardCalib() {
+  if (!calib.beginDownwardCalib(topEnc->getCount())) return false;
   baseDiff = bottomEnc->getCount() - topEnc->getCount();
   calibListen = true;
   return true;
 }
 
-bool servoCompleteCalib() {
-  calibListen = false;
-  servoOff();
-  vTaskDelay(pdMS_TO_TICKS(1000));
-  if (!calib.completeCalib(*topEnc)) return false;
+// Call calibSettleMs after servoPauseCalib()
+bool BlindPort::servoCompleteCalib() {
+  if (!calib.completeCalib(topEnc->getCount())) return false;
   initMainLoop();
   return true;
 }
 
-void initMainLoop() {
-  topEnc->setupWatchdog();
+void BlindPort::initMainLoop() {
+  servoPublishState(); // new range
+  savedEdgeUs = topEnc->getLastEdgeUs();
+  stallWatch = true;
   servoSavePos();
+  servoSnapshot();
   bottomEnc->wandListen.store(true, std::memory_order_release);
 }
 
-void IRAM_ATTR watchdogCallback(void* arg) {
+// Periodic check from the motion task, replacing the per-detent esp_timer restart.
+void BlindPort::servoStallCheck() {
+  if (!stallWatch) return;
+  int64_t now = esp_timer_get_time();
+  uint32_t lastEdgeUs = topEnc->getLastEdgeUs();
   if (runningManual || runningServer) {
-    // if we're trying to move and our timer ran out, we need to recalibrate
+    // nothing to supervise until the motor is actually driven
+    uint32_t periodUs = 0;
+    EdgeSample last[2];
+    if (topEnc->getEdges(last, 2) == 2) periodUs = last[0].timeUs - last[1].timeUs;
+    float commanded = runningServer ? fabsf(profile.getRefVelocity()) : 0;
+    uint32_t since;
+    if (!stall.stalled(now, lastEdgeUs, periodUs, commanded, since)) return;
+
+    // if we're trying to move and the motor stopped turning, we need to recalibrate
+    printf("Port %d stalled: no detent for %lu ms\n", cfg.num, since / 1000);
     clearCalibFlag = true;
-    topEnc->pauseWatchdog();
+    stallWatch = false;
 
     // get ready for recalibration by clearing all these listeners
     bottomEnc->wandListen.store(false, std::memory_order_release);
@@ -151,21 +360,23 @@ void IRAM_ATTR watchdogCallback(void* arg) {
     topEnc->serverListen.store(false, std::memory_order_release);
     servoOff();
   }
-  else {
-    // if no movement is running, we're fine
+  else if (lastEdgeUs != savedEdgeUs && (uint32_t)now - lastEdgeUs >= idleSaveMs * 1000) {
+    // no movement is running and the motor has settled
     // save current servo-encoder position for reinitialization
+    savedEdgeUs = lastEdgeUs;
     savePosFlag = true;
+    if (follow.isActive()) followReport();
   }
-  // clear running flags
-  runningManual = false;
-  runningServer = false;
 }
 
-void servoSavePos() {
+// Returns the state whose position was saved
+MotionState BlindPort::servoSavePos() {
   // save current servo-encoder position for use on reinitialization
+  MotionState s = state.read();
+  int32_t topCount = s.topCount;
+  if (journalSave(cfg.num, topCount)) return s;
   nvs_handle_t servoHandle;
-  if (nvs_open(nvsServo, NVS_READWRITE, &servoHandle) == ESP_OK) {
-    int32_t topCount = topEnc->getCount();
+  if (nvs_open(cfg.nvsServoNs, NVS_READWRITE, &servoHandle) == ESP_OK) {
     if (nvs_set_i32(servoHandle, posTag, topCount) != ESP_OK)
       printf("Error saving current position\n");
     else printf("Success - Current position saved as: %d\n", topCount);
@@ -175,13 +386,18 @@ void servoSavePos() {
   else {
     printf("Error opening servoPos NVS segment.\n");
   }
+  return s;
 }
 
-int32_t servoReadPos() {
-  // save current servo-encoder position for use on reinitialization
+int32_t BlindPort::servoReadPos() {
+  // read saved servo-encoder position; NVS holds it from before the journal existed
   int32_t val = 0;
+  if (journalRead(cfg.num, val)) {
+    printf("Success - Current position recovered as: %d\n", val);
+    return val;
+  }
   nvs_handle_t servoHandle;
-  if (nvs_open(nvsServo, NVS_READONLY, &servoHandle) == ESP_OK) {
+  if (nvs_open(cfg.nvsServoNs, NVS_READONLY, &servoHandle) == ESP_OK) {
     if (nvs_get_i32(servoHandle, posTag, &val) != ESP_OK)
       printf("Error reading current position\n");
     else printf("Success - Current position read as: %d\n", val);
@@ -193,21 +409,67 @@ int32_t servoReadPos() {
   return val;
 }
 
-void stopServerRun() {
+// Mirror count, calibration status and target into RTC memory. Motion task,
+// after every motor detent, so it is already current when a brownout resets us.
+void BlindPort::servoSnapshot() {
+  MotionState s = state.read();
+  RtcSnapshot& snap = rtcSnapshots[this - ports];
+  snap.crc = 0; // invalid while the fields are being updated
+  snap.magic = SNAPSHOT_MAGIC;
+  snap.count = s.topCount;
+  snap.target = s.target;
+  snap.calibrated = calib.getCalibrated();
+  snap.moving = runningServer;
+  snap.reserved[0] = snap.reserved[1] = 0;
+  snap.crc = snapshotCrc(snap);
+}
+
+bool BlindPort::servoRestoreSnapshot(int32_t& pos) {
+  RtcSnapshot& snap = rtcSnapshots[this - ports];
+  if (snap.magic != SNAPSHOT_MAGIC || snap.crc != snapshotCrc(snap)) return false;
+  // a calibration change since the snapshot means its count no longer maps to the range
+  if ((bool)snap.calibrated != calib.getCalibrated()) {
+    printf("RTC snapshot calibration mismatch - ignoring\n");
+    return false;
+  }
+  pos = snap.count;
+  printf("Success - Current position restored from RTC as: %d (reset reason %d)\n", pos, esp_reset_reason());
+  if (snap.moving) printf("Move to %d was interrupted by the reset\n", snap.target);
+  return true;
+}
+
+// Capture both counts, the range and the move state in one seqlock write, so
+// listeners and other tasks see a single detent rather than a mix of fields.
+void BlindPort::servoPublishState() {
+  MotionState s;
+  s.topCount = topEnc->getCount();
+  s.bottomCount = bottomEnc->getCount();
+  s.upBound = calib.UpTicks.load(std::memory_order_relaxed);
+  s.downBound = calib.DownTicks.load(std::memory_order_relaxed);
+  s.baseDiff = baseDiff;
+  s.target = target;
+  s.lashShift = lashLead(driveDir);
+  s.startLess = startLess;
+  s.appPos = calib.convertToAppPos(s.topCount - s.lashShift);
+  state.write(s);
+}
+
+void BlindPort::stopServerRun() {
   // stop listener and stop running if serverRun is still active.
   topEnc->serverListen.store(false, std::memory_order_release);
   if (runningServer) servoOff();
 }
 
-void servoWandListen() {
+void BlindPort::servoWandListen() {
   // stop any remote-initiated movement
   stopServerRun();
 
-  // freeze atomic values
-  int32_t upBound = calib.UpTicks;
-  int32_t downBound = calib.DownTicks;
-  int32_t bottomCount = bottomEnc->getCount();
-  int32_t topCount = topEnc->getCount();
+  // one consistent view of this detent
+  MotionState s = state.read();
+  int32_t upBound = s.upBound;
+  int32_t downBound = s.downBound;
+  int32_t bottomCount = s.bottomCount;
+  int32_t topCount = s.topCount;
 
   // ensure the baseDiff doesn't wait on wand to turn all the way back to original range.
   if ((upBound > downBound && bottomCount - baseDiff > upBound)
@@ -216,61 +478,173 @@ void servoWandListen() {
   else if ((upBound > downBound && bottomCount - baseDiff < downBound)
             || (upBound < downBound && bottomCount - baseDiff > downBound))
     baseDiff = bottomCount - downBound;
-  
+
   // calculate the difference between wand and top servo
   int32_t effDiff = (bottomCount - topCount) - baseDiff;
+  follow.observe(effDiff);
 
-  // if we are at either bound, stop servo and servo-listener
-  // if effective difference is 0, stop servo and servo-listener
-  // otherwise, run servo in whichever direction necessary and
-  // ensure servo-listener is active.
-  if (topCount >= (MAX(upBound, downBound) - 1)
-      && effDiff > 1) { // TODO: see whether these margins need to be removed.
+  // follow the wand at a speed set by the difference unless the follow law
+  // says stop or we are at the bound in the drive direction
+  int32_t duty = follow.duty(effDiff, bottomEnc->getVelocity(), calib.gains.kf, runningManual || runningServer);
+  bool atBound = duty > 0 ? topCount >= (MAX(upBound, downBound) - 1)  // TODO: see whether these margins need to be removed.
+                          : topCount <= (MIN(upBound, downBound) + 1);
+  if (duty == 0 || atBound) {
     servoOff();
     topEnc->wandListen.store(false, std::memory_order_release);
+    return;
   }
-  else if (topCount <= (MIN(upBound, downBound) + 1)
-      && effDiff < -1) {
-    servoOff();
-    topEnc->wandListen.store(false, std::memory_order_release);
+  // hear from the motor as it closes in on the wand, or once it passes the
+  // wand when running on inside the deadband
+  int8_t dir = duty > 0 ? 1 : -1;
+  int32_t wandPos = bottomCount - baseDiff;
+  topEnc->setWatch(dir * effDiff > followDeadband ? wandPos - dir : wandPos + dir);
+  topEnc->wandListen.store(true, std::memory_order_release);
+  servoFollow(effDiff, duty);
+}
+
+// Drive toward the wand. Re-evaluated on every wand and motor detent, so the
+// motor slows as it closes in instead of overrunning.
+void BlindPort::servoFollow(int32_t error, int32_t duty) {
+  bool fromRest = !runningManual && !runningServer;
+  follow.drive(error, duty, fromRest, esp_timer_get_time(), topEnc->getCount());
+  driveDir = duty > 0 ? 1 : -1;
+
+  profile.stop();
+  servoSetSpeed(duty, manual, fromRest ? ramp.startMs : 0);
+}
+
+void BlindPort::followReport() {
+  FollowStats f = follow.finish();
+  int64_t now = esp_timer_get_time();
+  printf("Port %d wand follow: %lld ms, max lag %d ticks, overshoot %d ticks, %u motor starts\n",
+         cfg.num, (now - f.startUs) / 1000, f.maxLag, f.overshoot, f.starts);
+
+  // A wand nudge right after a reversed move is the slats' error: further in the
+  // move's direction means the lash was underestimated, back means over.
+  if (lashSample.dir == 0 || now > lashSample.untilUs) return;
+  int32_t endCount = topEnc->getCount();
+  float correction = lashSample.dir * (endCount - f.startCount);
+  // Only a trim that leaves the motor near the move's target can be lash; a
+  // bigger move is the user picking a new position
+  if (fabsf(correction) > lashMaxTicks || abs(endCount - lashSample.target) > lashMaxTicks) {
+    printf("Port %d wand move of %.0f ticks is not a backlash sample\n", cfg.num, correction);
+    lashSample.dir = 0;
+    return;
   }
-  else if (effDiff > 1) {
-    topEnc->wandListen.store(true, std::memory_order_release);
-    servoOn(CCW, manual);
+  float& model = lashSample.dir > 0 ? calib.lashUp : calib.lashDown;
+  model = MIN(MAX(model + lashLearnRate * correction, 0.0f), lashMaxTicks);
+  printf("Port %d backlash %s corrected by %.0f ticks, now %.1f\n",
+         cfg.num, lashSample.dir > 0 ? "up" : "down", correction, model);
+  lashSample.dir = 0;
+  calib.saveLash();
+}
+
+// Motor lead over the slats once the lash is taken up in direction dir
+int32_t BlindPort::lashLead(int8_t dir) {
+  if (dir > 0) return (int32_t)(calib.lashUp + 0.5f);
+  if (dir < 0) return -(int32_t)(calib.lashDown + 0.5f);
+  return 0;
+}
+
+// Cut power once the remaining distance is within the learned coast for the current speed
+bool BlindPort::reachedCutPoint(int32_t topCount) {
+  int32_t remaining = startLess ? target - topCount : topCount - target;
+  float speed = (startLess ? 1 : -1) * topEnc->getVelocity() / 1000.0f;
+  float predicted = (speed > 0) ? (startLess ? calib.coastUp : calib.coastDown) * speed : 0;
+  return remaining <= (int32_t)(predicted + 0.5f);
+}
+
+void BlindPort::servoServerStop(int32_t topCount) {
+  if (runningServer) {
+    profile.report(topCount);
+    float speed = (startLess ? 1 : -1) * topEnc->getVelocity() / 1000.0f;
+    coast = {true, startLess, topCount, target, speed > 0 ? speed : 0, esp_timer_get_time()};
+    if (lashSample.dir != 0) lashSample.untilUs = esp_timer_get_time() + lashLearnMs * 1000;
   }
-  else if (effDiff < -1) {
-    topEnc->wandListen.store(true, std::memory_order_release);
-    servoOn(CW, manual);
+  stopServerRun();
+}
+
+void BlindPort::servoServerListen() {
+  // If we have reached our cut point, stop running and stop listener.
+  MotionState s = state.read();
+  if (reachedCutPoint(s.topCount)) servoServerStop(s.topCount);
+  else topEnc->setWatch(target); // re-arm in case the counter wrapped past it
+  baseDiff = s.bottomCount - s.topCount;
+}
+
+// Once the motor has come to rest after a server stop, learn how far it coasted.
+void BlindPort::servoCoastCheck() {
+  if (!coast.pending) return;
+  if (runningServer || runningManual) {
+    // moving again before settling - sample is meaningless
+    coast.pending = false;
+    return;
   }
-  else {
-    servoOff();
-    topEnc->wandListen.store(false, std::memory_order_release);
+  int64_t now = esp_timer_get_time();
+  if (now - coast.cutUs < coastSettleMs * 1000
+      || (uint32_t)now - topEnc->getLastEdgeUs() < coastSettleMs * 1000) return;
+  coast.pending = false;
+
+  int32_t finalPos = topEnc->getCount();
+  int32_t coasted = coast.up ? finalPos - coast.cutPos : coast.cutPos - finalPos;
+  if (coast.speed > profileSettleVel) {
+    float& model = coast.up ? calib.coastUp : calib.coastDown;
+    float sample = (coasted > 0 ? coasted : 0) / coast.speed;
+    model += coastLearnRate * (sample - model);
+    calib.saveCoast();
   }
+
+  int32_t error = coast.up ? finalPos - coast.goal : coast.goal - finalPos;
+  stopErrorHist[(error < -3 ? -3 : (error > 3 ? 3 : error)) + 3]++;
+  printf("Port %d stop error %d ticks (coasted %d at %.1f ticks/s), histogram <=-3..>=3: %lu %lu %lu %lu %lu %lu %lu\n",
+         cfg.num, error, coasted, coast.speed, stopErrorHist[0], stopErrorHist[1], stopErrorHist[2],
+         stopErrorHist[3], stopErrorHist[4], stopErrorHist[5], stopErrorHist[6]);
 }
 
-void servoServerListen() {
-  // If we have reached or passed our goal, stop running and stop listener.
-  if (topEnc->getCount() >= target && startLess) stopServerRun();
-  else if (topEnc->getCount() <= target && !startLess) stopServerRun();
-  baseDiff = bottomEnc->getCount() - topEnc->getCount();
+bool BlindPort::servoProfileActive() {
+  return profile.isActive();
 }
 
-void runToAppPos(uint8_t appPos) {
+// One control period of the server move speed profile (motion task).
+void BlindPort::servoProfileTick(float dt) {
+  if (!profile.isActive() || runningManual) return;
+  int32_t duty;
+  int32_t topCount = topEnc->getCount();
+  if (reachedCutPoint(topCount)) servoServerStop(topCount);
+  else if (profile.update(topCount, topEnc->getVelocity() / 1000.0f, dt, calib.gains, duty))
+    servoSetSpeed(duty, server);
+  else servoServerStop(topCount);
+}
+
+void BlindPort::runToAppPos(uint16_t appPos) {
   // manual control takes precedence over remote control, always.
   // also do not begin operation if not calibrated;
   if (runningManual || !calib.getCalibrated()) return;
-  servoOff();
-
-  target = calib.convertToTicks(appPos); // calculate target encoder position
-  printf("runToAppPos Called, running to %d from %d", target.load(), topEnc->getCount());
 
-  // allow servo position to settle
-  vTaskDelay(pdMS_TO_TICKS(500));
+  int32_t goal = calib.convertToTicks(appPos); // slat position in encoder ticks
   int32_t topCount = topEnc->getCount();
-  if (abs(topCount - target) <= 1) return;
-  startLess = topCount < target;
+  printf("runToAppPos Called, port %d running to %d from %d\n", cfg.num, goal, topCount);
+
+  // No settle wait: an active profile is retargeted and brakes or reverses on its own
+  int32_t slatPos = topCount - lashLead(driveDir);
+  if (abs(slatPos - goal) <= 1 && !profile.isActive()) return;
+  startLess = slatPos < goal;
+
+  // Lead the slats by the lash for this direction; after a reversal that
+  // means first taking up the play the previous move left on the other side
+  int8_t dir = startLess ? 1 : -1;
+  bool reversed = driveDir == -dir;
+  driveDir = dir;
+  target = goal + lashLead(dir);
+  target = MIN(MAX(target, MIN(calib.UpTicks.load(), calib.DownTicks.load())),
+               MAX(calib.UpTicks.load(), calib.DownTicks.load()));
+  lashSample = {reversed ? dir : (int8_t)0, 0, target};
+  servoPublishState();
   if (runningManual) return; // check again before starting remote control
-  if (startLess) servoOn(CCW, server); // begin servo movement
-  else servoOn(CW, server);
+  topEnc->setWatch(target); // hardware counters interrupt only at the target
+  runningServer = true;
+  servoSnapshot();
+  profile.start(target);
   topEnc->serverListen.store(true, std::memory_order_release); // start listening for shutoff point
-}
\ No newline at end of file
+  motionWake();
+}
@@ -6,20 +6,421 @@
 #include "cJSON.h"
 #include "calibration.hpp"
 #include "servo.hpp"
+#include "motion.hpp"
 #include "defines.h"
 #include "esp_crt_bundle.h"
+#include "esp_timer.h"
+#include "esp_websocket_client.h"
+#include "freertos/semphr.h"
+#include "eventWriter.hpp"
+#include "jsonTokens.hpp"
 
 static esp_socketio_client_handle_t io_client;
 static esp_socketio_packet_handle_t tx_packet = NULL;
+static esp_websocket_client_handle_t ws_client = NULL; // underlying websocket, once an event names it
+
+// Outbound events are formatted into one static frame, so emitting never
+// allocates on the heap shared with TLS. The lock serialises emitters.
+static char txFrame[sioTxFrameSize];
+static EventWriter txWriter(txFrame, sizeof(txFrame), "");
+static SemaphoreHandle_t txLock = NULL;
 
 std::atomic<bool> statusResolved{true};
 std::atomic<bool> connected{false};
 
+static std::atomic<uint32_t> emitsSent{0};
+static std::atomic<uint32_t> emitsFailed{0};
+static std::atomic<uint32_t> emitAllocs{0};    // heap allocations made while emitting
+static std::atomic<uint32_t> emitAllocsMax{0}; // worst single emit
+
+// Events emitted while offline wait here and go out in order once
+// device_init succeeds. State events keep only their newest copy per
+// (event, port); one-shot calibration events belong to a flow the server
+// restarts on reconnect, so they are dropped instead. Guarded by txLock.
+enum EventKind : uint8_t {
+  EVENT_STATE,   // replaces the previous report; replayed after reconnecting
+  EVENT_ONESHOT, // only meaningful on this connection
+};
+
+struct QueuedEvent {
+  uint32_t hash; // event name
+  int port;
+  EventKind kind;
+  int64_t queuedUs;
+  uint16_t len;
+  char frame[sioTxFrameSize];
+};
+static QueuedEvent txQueue[sioQueueLen];
+static uint8_t txOrder[sioQueueLen]; // slots, oldest first
+static uint8_t txQueued = 0;
+static uint32_t txEventHash = 0; // key of the frame being built
+static int txEventPort = 0;
+static EventKind txEventKind = EVENT_STATE;
+static std::atomic<uint32_t> emitsQueued{0};
+static std::atomic<uint32_t> emitsCoalesced{0}; // replaced by a newer event for the same port
+static std::atomic<uint32_t> emitsDropped{0};   // queue full or too old to replay
+
+static void flushEvents();
+static void dropOneShots();
+
+// Server events. Each handler gets the tokenized frame and the index of the
+// event's data token; handlers registered with a port argument also get the
+// validated local port.
+enum PortArg : uint8_t {
+  NO_PORT,    // handler reads its own payload
+  PORT,       // data.port must name a local port
+  CALIB_PORT, // as PORT, and an unknown port is reported as a calibration error
+};
+
+typedef void (*EventHandler)(const JsonDoc& doc, int data, BlindPort* port);
+
+struct EventRoute {
+  const char* name;
+  uint32_t hash;
+  PortArg portArg;
+  EventHandler handler;
+};
+
+struct EventStats {
+  std::atomic<uint32_t> calls;
+  std::atomic<uint32_t> rejected; // bad or unknown port
+  std::atomic<uint32_t> totalUs;
+  std::atomic<uint32_t> maxUs;
+};
+
+// FNV-1a, evaluated at compile time for the route table
+static constexpr uint32_t eventHash(const char* s, uint32_t h = 2166136261u) {
+  return *s ? eventHash(s + 1, (h ^ (uint8_t)*s) * 16777619u) : h;
+}
+
+// Same hash over a name that isn't NUL-terminated
+static uint32_t eventHash(const char* s, size_t len) {
+  uint32_t h = 2166136261u;
+  while (len--) h = (h ^ (uint8_t)*s++) * 16777619u;
+  return h;
+}
+
+static void onError(const JsonDoc& doc, int data, BlindPort*) {
+  printf("Received error message from server\n");
+  int message = doc.get(data, "message");
+  if (doc.isString(message)) {
+    printf("Server error: %.*s\n", doc.length(message), doc.text(message));
+  }
+
+  // Mark connection as failed
+  connected = false;
+  statusResolved = true;
+}
+
+static void onDeviceInit(const JsonDoc& doc, int data, BlindPort*) {
+  printf("Received device_init message\n");
+  if (doc.equals(doc.get(data, "type"), "success")) {
+    printf("Device authenticated successfully\n");
+
+    // Parse device state
+    int deviceState = doc.get(data, "deviceState");
+    if (doc.isArray(deviceState)) {
+      int stateCount = doc.size(deviceState);
+      printf("Device has %d peripheral(s):\n", stateCount);
+
+      for (int i = 0, periph = deviceState + 1; i < stateCount; i++, periph = doc.next(periph)) {
+        int32_t port = 0;
+        int32_t lastPos = 0;
+        if (!doc.getInt(doc.get(periph, "port"), port) || !doc.getInt(doc.get(periph, "lastPos"), lastPos)) {
+          printf("  Invalid peripheral state\n");
+          continue;
+        }
+        // TODO: UPDATE MOTOR/ENCODER STATES BASED ON THIS, as well as the successive websocket updates.
+        printf("  Port %d: pos=%d\n", port, lastPos);
+        BlindPort* local = getPort(port);
+        if (local == nullptr) printf("ERROR: UNKNOWN PORT %d RECEIVED\n", port);
+        // A position reached while offline is newer than the server's: keep
+        // it and report it, replacing anything older still queued
+        else if (local->movedOffline.exchange(false)) {
+          printf("  Port %d moved while offline, keeping local position\n", port);
+          emitPosHit(local->getMotionState().appPos, port);
+        }
+        else motionSubmit(MOTION_MOVE, port, lastPos);
+      }
+    }
+
+    // Report back actual calibration status of every local port. These join
+    // the offline queue and replace any stale reports in it.
+    for (BlindPort& port : ports) {
+      bool deviceCalibrated = port.calib.getCalibrated();
+      emitCalibStatus(deviceCalibrated, port.cfg.num);
+      printf("  Reported calibrated=%d for port %d\n", deviceCalibrated, port.cfg.num);
+    }
+
+    // Now mark as connected and replay what was emitted while offline
+    connected = true;
+    flushEvents();
+    statusResolved = true;
+  } else {
+    printf("Device authentication failed\n");
+    for (BlindPort& port : ports) port.calib.clearCalibrated();
+    deleteWiFiAndTokenDetails();
+    connected = false;
+    statusResolved = true;
+  }
+}
+
+static void onDeviceDeleted(const JsonDoc& doc, int data, BlindPort*) {
+  printf("Device has been deleted from account - disconnecting\n");
+  int message = doc.get(data, "message");
+  if (doc.isString(message)) {
+    printf("Server message: %.*s\n", doc.length(message), doc.text(message));
+  }
+  for (BlindPort& port : ports) port.calib.clearCalibrated();
+  deleteWiFiAndTokenDetails();
+  connected = false;
+  statusResolved = true;
+}
+
+static void onCalibStart(const JsonDoc&, int, BlindPort* port) {
+  printf("Device calibration begun, setting up...\n");
+  printf("Running initCalib...\n");
+  motionSubmit(MOTION_CALIB_START, port->cfg.num);
+}
+
+static void onStage1Complete(const JsonDoc&, int, BlindPort* port) {
+  printf("User completed stage 1 (tilt up), switching direction...\n");
+  motionSubmit(MOTION_CALIB_STAGE1, port->cfg.num);
+}
+
+static void onStage2Complete(const JsonDoc&, int, BlindPort* port) {
+  printf("User completed stage 2 (tilt down), finalizing calibration...\n");
+  motionSubmit(MOTION_CALIB_STAGE2, port->cfg.num);
+}
+
+// Sweep to both end stops without the user
+static void onCalibAuto(const JsonDoc&, int, BlindPort* port) {
+  printf("Automatic calibration requested\n");
+  motionSubmit(MOTION_CALIB_AUTO, port->cfg.num);
+}
+
+static void onCancelCalib(const JsonDoc&, int, BlindPort* port) {
+  printf("Canceling calibration process...\n");
+  motionSubmit(MOTION_CANCEL, port->cfg.num);
+}
+
+// Server position change (manual or scheduled)
+static void onPosUpdates(const JsonDoc& doc, int updateList, BlindPort*) {
+  printf("Received position update from server\n");
+  if (!doc.isArray(updateList)) return;
+  int updateCount = doc.size(updateList);
+  printf("Processing %d position update(s)\n", updateCount);
+
+  for (int i = 0, update = updateList + 1; i < updateCount; i++, update = doc.next(update)) {
+    int32_t port = 0;
+    int32_t position = 0;
+    if (doc.getInt(doc.get(update, "periphNum"), port) &&
+        doc.getInt(doc.get(update, "pos"), position)) {
+      // Only the newest update per port is executed
+      bool superseded = false;
+      int32_t laterPort;
+      for (int j = i + 1, later = doc.next(update); j < updateCount && !superseded; j++, later = doc.next(later))
+        superseded = doc.getInt(doc.get(later, "periphNum"), laterPort) && laterPort == port;
+
+      if (superseded) movesCoalesced++;
+      else if (getPort(port) == nullptr)
+        printf("ERROR: Received position update for unknown port: %d\n", port);
+      else {
+        printf("Position update: port %d position %d\n", port, position);
+        motionSubmit(MOTION_MOVE, port, position);
+      }
+    }
+    else printf("Invalid position update format\n");
+  }
+}
+
+// Position curve change: per-mille of travel at each knot
+static void onPosCurve(const JsonDoc& doc, int data, BlindPort* port) {
+  int curve = doc.get(data, "curve");
+  if (!doc.isArray(curve) || doc.size(curve) != curveKnots) {
+    printf("Error, position curve needs %d knots\n", curveKnots);
+    return;
+  }
+  int32_t values[curveKnots];
+  for (int i = 0, item = curve + 1; i < curveKnots; i++, item = doc.next(item)) {
+    if (!doc.getInt(item, values[i])) {
+      printf("Error, position curve knots must be numbers\n");
+      return;
+    }
+  }
+  uint16_t knots[curveKnots];
+  if (!Calibration::curveFromKnots(values, knots)) {
+    printf("Error, position curve must rise from 0 to 1000\n");
+    return;
+  }
+  motionSubmitCurve(port->cfg.num, knots);
+}
+
+#define ROUTE(name, portArg, handler) {name, eventHash(name), portArg, handler}
+static constexpr EventRoute routes[] = {
+  ROUTE("error", NO_PORT, onError),
+  ROUTE("device_init", NO_PORT, onDeviceInit),
+  ROUTE("device_deleted", NO_PORT, onDeviceDeleted),
+  ROUTE("calib_start", CALIB_PORT, onCalibStart),
+  ROUTE("user_stage1_complete", CALIB_PORT, onStage1Complete),
+  ROUTE("user_stage2_complete", CALIB_PORT, onStage2Complete),
+  ROUTE("calib_auto", CALIB_PORT, onCalibAuto),
+  ROUTE("cancel_calib", CALIB_PORT, onCancelCalib),
+  ROUTE("posUpdates", NO_PORT, onPosUpdates),
+  ROUTE("pos_curve", PORT, onPosCurve),
+};
+#define NUM_ROUTES (sizeof(routes) / sizeof(routes[0]))
+#define ROUTE_SLOTS 32 // open-addressed hash index, power of two
+#define ROUTE_EMPTY 0xFF
+static_assert(NUM_ROUTES * 2 <= ROUTE_SLOTS, "grow ROUTE_SLOTS with the route table");
+
+static constexpr bool routeHashesUnique() {
+  for (size_t i = 0; i < NUM_ROUTES; i++)
+    for (size_t j = i + 1; j < NUM_ROUTES; j++)
+      if (routes[i].hash == routes[j].hash) return false;
+  return true;
+}
+static_assert(routeHashesUnique(), "event name hash collision - rename the event");
+
+// Hash to route index, built at compile time with linear probing
+struct RouteIndex {
+  uint8_t slot[ROUTE_SLOTS];
+};
+static constexpr RouteIndex buildRouteIndex() {
+  RouteIndex index = {};
+  for (size_t k = 0; k < ROUTE_SLOTS; k++) index.slot[k] = ROUTE_EMPTY;
+  for (size_t i = 0; i < NUM_ROUTES; i++) {
+    uint32_t k = routes[i].hash & (ROUTE_SLOTS - 1);
+    while (index.slot[k] != ROUTE_EMPTY) k = (k + 1) & (ROUTE_SLOTS - 1);
+    index.slot[k] = i;
+  }
+  return index;
+}
+static constexpr RouteIndex routeIndex = buildRouteIndex();
+
+static EventStats routeStats[NUM_ROUTES] = {};
+static std::atomic<uint32_t> unknownEvents{0};
+
+static const EventRoute* findRoute(const char* name, size_t len) {
+  uint32_t hash = eventHash(name, len);
+  for (uint32_t k = hash & (ROUTE_SLOTS - 1); routeIndex.slot[k] != ROUTE_EMPTY; k = (k + 1) & (ROUTE_SLOTS - 1)) {
+    const EventRoute& route = routes[routeIndex.slot[k]];
+    if (route.hash == hash && strlen(route.name) == len && memcmp(route.name, name, len) == 0) return &route;
+  }
+  return nullptr;
+}
+
+// Look up, validate the port argument, run and time one server event
+static void routeEvent(const JsonDoc& doc, int nameToken, int data) {
+  const char* name = doc.text(nameToken);
+  int nameLen = doc.length(nameToken);
+  const EventRoute* route = findRoute(name, nameLen);
+  if (route == nullptr) {
+    unknownEvents++;
+    printf("Unhandled server event: %.*s\n", nameLen, name);
+    return;
+  }
+  EventStats& stats = routeStats[route - routes];
+  stats.calls++;
+
+  BlindPort* port = nullptr;
+  if (route->portArg != NO_PORT) {
+    int32_t portNum;
+    if (!doc.getInt(doc.get(data, "port"), portNum)) {
+      stats.rejected++;
+      printf("Error, %s without a port\n", route->name);
+      return;
+    }
+    port = getPort(portNum);
+    if (port == nullptr) {
+      stats.rejected++;
+      printf("Error, unknown port %d received for %s\n", portNum, route->name);
+      if (route->portArg == CALIB_PORT) emitCalibError("Unknown port", portNum);
+      return;
+    }
+  }
+
+  int64_t startUs = esp_timer_get_time();
+  route->handler(doc, data, port);
+  uint32_t elapsed = esp_timer_get_time() - startUs;
+  stats.totalUs += elapsed;
+  if (elapsed > stats.maxUs) stats.maxUs = elapsed;
+}
+
+// Tokenize one event array, ["name", data], in place and route it
+static void handleEventJson(const char* json, size_t len) {
+  static JsonToken tokens[sioMaxTokens]; // websocket task only
+  int count = jsonTokenize(json, len, tokens, sioMaxTokens);
+  if (count < 0) {
+    printf("Malformed Socket.IO event (%d)\n", count);
+    return;
+  }
+  JsonDoc doc = {json, tokens, count};
+  if (doc.isArray(0) && doc.size(0) >= 2 && doc.isString(1)) routeEvent(doc, 1, doc.next(1));
+}
+
+void socketLogStats() {
+  static uint32_t lastCalls[NUM_ROUTES] = {};
+  for (size_t i = 0; i < NUM_ROUTES; i++) {
+    EventStats& stats = routeStats[i];
+    uint32_t calls = stats.calls;
+    if (calls == lastCalls[i]) continue;
+    lastCalls[i] = calls;
+    uint32_t handled = calls - stats.rejected;
+    printf("Event %s: %lu calls, %lu rejected, avg %lu us, max %lu us\n", routes[i].name,
+           calls, stats.rejected.load(), handled ? stats.totalUs / handled : 0, stats.maxUs.load());
+  }
+  static uint32_t lastSent = 0;
+  static uint32_t lastFailed = 0;
+  uint32_t sent = emitsSent;
+  uint32_t failed = emitsFailed;
+  if (sent != lastSent || failed != lastFailed) {
+    lastSent = sent;
+    lastFailed = failed;
+    printf("Emits: %lu sent, %lu failed, %lu heap allocations (max %lu in one emit)\n",
+           sent, failed, emitAllocs.load(), emitAllocsMax.load());
+  }
+  static uint32_t lastQueued = 0;
+  uint32_t queued = emitsQueued;
+  if (queued != lastQueued) {
+    lastQueued = queued;
+    printf("Offline emits: %lu queued, %lu coalesced, %lu dropped, %u waiting\n",
+           queued, emitsCoalesced.load(), emitsDropped.load(), txQueued);
+  }
+
+  static uint32_t lastUnknown = 0;
+  uint32_t unknown = unknownEvents;
+  if (unknown != lastUnknown) {
+    lastUnknown = unknown;
+    printf("Unhandled server events: %lu\n", unknown);
+  }
+}
+
+// JSON part of a complete, unfragmented 42["name",...] text frame, or NULL.
+// Skips the namespace and ack id that may follow the packet type.
+static const char* eventJson(const esp_websocket_event_data_t *ws_event, size_t& len) {
+  if (ws_event->op_code != 0x1 || ws_event->payload_offset != 0
+      || ws_event->data_len != ws_event->payload_len || ws_event->data_len < 3) return NULL;
+  const char *p = ws_event->data_ptr;
+  const char *end = p + ws_event->data_len;
+  if (p[0] != '4' || p[1] != '2') return NULL;
+  p += 2;
+  if (p < end && *p == '/') {
+    while (p < end && *p != ',') p++;
+    p++;
+  }
+  while (p < end && *p >= '0' && *p <= '9') p++;
+  if (p >= end || *p != '[') return NULL;
+  len = end - p;
+  return p;
+}
+
 // Event handler for Socket.IO events
 static void socketio_event_handler(void *handler_args, esp_event_base_t base, 
                                  int32_t event_id, void *event_data) {
   esp_socketio_event_data_t *data = (esp_socketio_event_data_t *)event_data;
   esp_socketio_packet_handle_t packet = data->socketio_packet;
+  if (data->websocket_event && data->websocket_event->client) ws_client = data->websocket_event->client;
 
   switch (event_id) {
     case SOCKETIO_EVENT_OPENED:
@@ -41,210 +442,22 @@ static void socketio_event_handler(void *handler_args, esp_event_base_t base,
         
     case SOCKETIO_EVENT_DATA: {
       printf("Received Socket.IO data\n");
-      // Parse the received packet
-      cJSON *json = esp_socketio_packet_get_json(packet);
+      // Tokenize the event straight out of the websocket frame when it arrived whole
+      esp_websocket_event_data_t *ws_event = data->websocket_event;
+      size_t len = 0;
+      const char *json = ws_event ? eventJson(ws_event, len) : NULL;
       if (json) {
-        char *json_str = cJSON_Print(json);
+        printf("Data: %.*s\n", (int)len, json);
+        handleEventJson(json, len);
+        break;
+      }
+
+      // Otherwise fall back to the client's parsed packet
+      cJSON *parsed = esp_socketio_packet_get_json(packet);
+      char *json_str = parsed ? cJSON_PrintUnformatted(parsed) : NULL;
+      if (json_str) {
         printf("Data: %s\n", json_str);
-        
-        // Check if this is an array event
-        if (cJSON_IsArray(json) && cJSON_GetArraySize(json) >= 2) {
-          cJSON *eventName = cJSON_GetArrayItem(json, 0);
-          
-          if (cJSON_IsString(eventName)) {
-            // Handle error event
-            if (strcmp(eventName->valuestring, "error") == 0) {
-              printf("Received error message from server\n");
-              cJSON *data = cJSON_GetArrayItem(json, 1);
-              
-              if (data) {
-                cJSON *message = cJSON_GetObjectItem(data, "message");
-                if (message && cJSON_IsString(message)) {
-                  printf("Server error: %s\n", message->valuestring);
-                }
-              }
-              
-              // Mark connection as failed
-              connected = false;
-              statusResolved = true;
-            }
-            // Handle device_init event
-            else if (strcmp(eventName->valuestring, "device_init") == 0) {
-              printf("Received device_init message\n");
-              cJSON *data = cJSON_GetArrayItem(json, 1);
-              
-              if (data) {
-                cJSON *type = cJSON_GetObjectItem(data, "type");
-                if (type && strcmp(type->valuestring, "success") == 0) {
-                  printf("Device authenticated successfully\n");
-                  
-                  // Parse device state
-                  cJSON *deviceState = cJSON_GetObjectItem(data, "deviceState");
-                  if (cJSON_IsArray(deviceState)) {
-                    int stateCount = cJSON_GetArraySize(deviceState);
-                    printf("Device has %d peripheral(s):\n", stateCount);
-                    
-                    for (int i = 0; i < stateCount; i++) {
-                      cJSON *periph = cJSON_GetArrayItem(deviceState, i);
-                      int port = cJSON_GetObjectItem(periph, "port")->valueint;
-                      int lastPos = cJSON_GetObjectItem(periph, "lastPos")->valueint;
-                      // TODO: UPDATE MOTOR/ENCODER STATES BASED ON THIS, as well as the successive websocket updates.
-                      printf("  Port %d: pos=%d\n", port, lastPos);
-                      if (port != 1) printf("ERROR: NON-1 PORT RECEIVED\n");
-                      // Report back actual calibration status from device
-                      else {
-                        bool deviceCalibrated = calib.getCalibrated();
-                        emitCalibStatus(deviceCalibrated);
-                        printf("  Reported calibrated=%d for port %d\n", deviceCalibrated, port);
-                        runToAppPos(lastPos);
-                      }
-                    }
-                  }
-                  
-                  // Now mark as connected
-                  connected = true;
-                  statusResolved = true;
-                } else {
-                  printf("Device authentication failed\n");
-                  calib.clearCalibrated();
-                  deleteWiFiAndTokenDetails();
-                  connected = false;
-                  statusResolved = true;
-                }
-              }
-            }
-            // Handle device_deleted event
-            else if (strcmp(eventName->valuestring, "device_deleted") == 0) {
-              printf("Device has been deleted from account - disconnecting\n");
-              cJSON *data = cJSON_GetArrayItem(json, 1);
-              if (data) {
-                cJSON *message = cJSON_GetObjectItem(data, "message");
-                if (message && cJSON_IsString(message)) {
-                  printf("Server message: %s\n", message->valuestring);
-                }
-              }
-              calib.clearCalibrated();
-              deleteWiFiAndTokenDetails();
-              connected = false;
-              statusResolved = true;
-            }
-
-            // Handle calib_start event
-            else if (strcmp(eventName->valuestring, "calib_start") == 0) {
-              printf("Device calibration begun, setting up...\n");
-              cJSON *data = cJSON_GetArrayItem(json, 1);
-              if (data) {
-                cJSON *port = cJSON_GetObjectItem(data, "port");
-                if (port && cJSON_IsNumber(port)) {
-                  if (port->valueint != 1) {
-                    printf("Error, non-1 port received for calibration\n");
-                    emitCalibError("Non-1 Port");
-                  }
-                  else {
-                    printf("Running initCalib...\n");
-                    if (!servoInitCalib()) {
-                      printf("initCalib returned False\n");
-                      emitCalibError("Initialization failed");
-                    }
-                    else {
-                      printf("Ready to calibrate\n");
-                      emitCalibStage1Ready();
-                    }
-                  }
-                }
-              }
-            }
-            
-            // Handle user_stage1_complete event
-            else if (strcmp(eventName->valuestring, "user_stage1_complete") == 0) {
-              printf("User completed stage 1 (tilt up), switching direction...\n");
-              cJSON *data = cJSON_GetArrayItem(json, 1);
-              if (data) {
-                cJSON *port = cJSON_GetObjectItem(data, "port");
-                if (port && cJSON_IsNumber(port)) {
-                  if (port->valueint != 1) {
-                    printf("Error, non-1 port received for calibration\n");
-                    emitCalibError("Non-1 Port");
-                  }
-                  else {
-                    if (!servoBeginDownwardCalib())
-                      emitCalibError("Direction Switch Failed");
-                    else emitCalibStage2Ready();
-                  }
-                }
-              }
-            }
-            
-            // Handle user_stage2_complete event
-            else if (strcmp(eventName->valuestring, "user_stage2_complete") == 0) {
-              printf("User completed stage 2 (tilt down), finalizing calibration...\n");
-              cJSON *data = cJSON_GetArrayItem(json, 1);
-              if (data) {
-                cJSON *port = cJSON_GetObjectItem(data, "port");
-                if (port && cJSON_IsNumber(port)) {
-                  if (port->valueint != 1) {
-                    printf("Error, non-1 port received for calibration\n");
-                    emitCalibError("Non-1 port");
-                  }
-                  else {
-                    if (!servoCompleteCalib()) emitCalibError("Completion failed");
-                    else emitCalibDone();
-                  }
-                }
-              }
-            }
-
-            // Handle user_stage1_complete event
-            else if (strcmp(eventName->valuestring, "cancel_calib") == 0) {
-              printf("Canceling calibration process...\n");
-              cJSON *data = cJSON_GetArrayItem(json, 1);
-              if (data) {
-                cJSON *port = cJSON_GetObjectItem(data, "port");
-                if (port && cJSON_IsNumber(port)) {
-                  if (port->valueint != 1) {
-                    printf("Error, non-1 port received for calibration\n");
-                    emitCalibError("Non-1 Port");
-                  }
-                  else {
-                    servoCancelCalib();
-                  }
-                }
-              }
-            }
-            
-            // Handle server position change (manual or scheduled)
-            else if (strcmp(eventName->valuestring, "posUpdates") == 0) {
-              printf("Received position update from server\n");
-              cJSON *updateList = cJSON_GetArrayItem(json, 1);
-              
-              if (cJSON_IsArray(updateList)) {
-                int updateCount = cJSON_GetArraySize(updateList);
-                printf("Processing %d position update(s)\n", updateCount);
-                
-                for (int i = 0; i < updateCount; i++) {
-                  cJSON *update = cJSON_GetArrayItem(updateList, i);
-                  cJSON *periphNum = cJSON_GetObjectItem(update, "periphNum");
-                  cJSON *pos = cJSON_GetObjectItem(update, "pos");
-                  
-                  if (periphNum && cJSON_IsNumber(periphNum) && 
-                      pos && cJSON_IsNumber(pos)) {
-                    int port = periphNum->valueint;
-                    int position = pos->valueint;
-                    
-                    if (port != 1)
-                      printf("ERROR: Received position update for non-1 port: %d\n", port);
-                    else {
-                      printf("Position update: position %d\n", position);
-                      runToAppPos(position);
-                    }
-                  } 
-                  else printf("Invalid position update format\n");
-                }
-              }
-            }
-          }
-        }
-        
+        handleEventJson(json_str, strlen(json_str));
         free(json_str);
       }
       break;
@@ -252,7 +465,7 @@ static void socketio_event_handler(void *handler_args, esp_event_base_t base,
         
     case SOCKETIO_EVENT_ERROR: {
       printf("Socket.IO Error!\n");
-      servoCancelCalib();
+      for (BlindPort& port : ports) motionSubmit(MOTION_CANCEL, port.cfg.num);
       esp_websocket_event_data_t *ws_event = data->websocket_event;
       
       if (ws_event) {
@@ -302,6 +515,7 @@ static void socketio_event_handler(void *handler_args, esp_event_base_t base,
   // Handle WebSocket-level disconnections
   if (data->websocket_event_id == WEBSOCKET_EVENT_DISCONNECTED) {
     printf("WebSocket disconnected\n");
+    ws_client = NULL;
     connected = false;
     statusResolved = true;
   }
@@ -314,6 +528,7 @@ void initSocketIO() {
 
   statusResolved = false;
   connected = false;
+  if (txLock == NULL) txLock = xSemaphoreCreateMutex();
   
   esp_socketio_client_config_t config = {};
   config.websocket_config.uri = uriString.c_str();
@@ -335,74 +550,216 @@ void stopSocketIO() {
   if (io_client != NULL) {
     printf("Stopping Socket.IO client...\n");
     esp_socketio_client_close(io_client, pdMS_TO_TICKS(1000));
+    xSemaphoreTake(txLock, portMAX_DELAY);
     esp_socketio_client_destroy(io_client);
     io_client = NULL;
     tx_packet = NULL;
+    ws_client = NULL;
+    dropOneShots(); // the server restarts any calibration on reconnect
+    xSemaphoreGive(txLock);
     connected = false;
     statusResolved = false;
   }
 }
 
-// Helper function to emit Socket.IO event with data
-static void emitSocketEvent(const char* eventName, cJSON* data) {
-  if (esp_socketio_packet_set_header(tx_packet, EIO_PACKET_TYPE_MESSAGE, 
-                                      SIO_PACKET_TYPE_EVENT, NULL, -1) == ESP_OK) {
-    cJSON *array = cJSON_CreateArray();
-    cJSON_AddItemToArray(array, cJSON_CreateString(eventName));
-    cJSON_AddItemToArray(array, data);
-    
-    esp_socketio_packet_set_json(tx_packet, array);
-    esp_socketio_client_send_data(io_client, tx_packet);
+// Counts heap allocations made by the task that holds txLock (CONFIG_HEAP_USE_HOOKS)
+static TaskHandle_t emitTask = NULL;
+static uint32_t allocsInEmit = 0;
+extern "C" IRAM_ATTR void esp_heap_trace_alloc_hook(void* ptr, size_t size, uint32_t caps) {
+  if (emitTask != NULL && xTaskGetCurrentTaskHandle() == emitTask) allocsInEmit++;
+}
+extern "C" IRAM_ATTR void esp_heap_trace_free_hook(void* ptr) {}
+
+// Every outbound event names the port it's about; together with the event
+// name that is its key in the offline queue.
+static EventWriter* beginEvent(const char* eventName, int port, EventKind kind) {
+  if (txLock == NULL || xSemaphoreTake(txLock, portMAX_DELAY) != pdTRUE) {
+    emitsFailed++;
+    return nullptr;
+  }
+  allocsInEmit = 0;
+  emitTask = xTaskGetCurrentTaskHandle();
+  txEventHash = eventHash(eventName);
+  txEventPort = port;
+  txEventKind = kind;
+  txWriter = EventWriter(txFrame, sizeof(txFrame), eventName);
+  txWriter.addNumber("port", port);
+  return &txWriter;
+}
+
+// Send a finished frame straight down the websocket once we have its
+// handle, otherwise through the client's cJSON packet path. Holds txLock.
+static bool sendFrame(const char* frame, size_t len) {
+  bool sent = false;
+  if (!connected) return false;
+  if (ws_client != NULL)
+    sent = esp_websocket_client_send_text(ws_client, frame, len, pdMS_TO_TICKS(1000)) >= 0;
+  else if (tx_packet != NULL && esp_socketio_packet_set_header(tx_packet, EIO_PACKET_TYPE_MESSAGE,
+                                                               SIO_PACKET_TYPE_EVENT, NULL, -1) == ESP_OK) {
+    cJSON *array = cJSON_ParseWithLength(frame + 2, len - 2);
+    if (array) {
+      esp_socketio_packet_set_json(tx_packet, array);
+      sent = esp_socketio_client_send_data(io_client, tx_packet) == ESP_OK;
+      cJSON_Delete(array);
+    }
     esp_socketio_packet_reset(tx_packet);
-    
-    cJSON_Delete(array);
-  } else {
-    // If packet header setup failed, clean up the data object
-    cJSON_Delete(data);
   }
+  return sent;
+}
+
+// Drop the queue entry at position i of txOrder, keeping the order of the rest
+static uint8_t unqueue(uint8_t i) {
+  uint8_t slot = txOrder[i];
+  memmove(&txOrder[i], &txOrder[i + 1], txQueued - i - 1);
+  txQueued--;
+  return slot;
+}
+
+// First queue slot not named in txOrder. Only called with room in the queue.
+static uint8_t freeSlot() {
+  for (uint8_t slot = 0; slot < sioQueueLen; slot++) {
+    bool used = false;
+    for (uint8_t i = 0; i < txQueued && !used; i++) used = txOrder[i] == slot;
+    if (!used) return slot;
+  }
+  return 0;
+}
+
+// Queue a frame behind everything else. A state event replaces an older one
+// with the same key. Holds txLock.
+static void queueFrame(uint32_t hash, int port, EventKind kind, const char* frame, size_t len) {
+  uint8_t slot = sioQueueLen;
+  for (uint8_t i = 0; i < txQueued && kind == EVENT_STATE; i++) {
+    if (txQueue[txOrder[i]].hash == hash && txQueue[txOrder[i]].port == port) {
+      slot = unqueue(i);
+      emitsCoalesced++;
+      break;
+    }
+  }
+  if (slot == sioQueueLen && txQueued == sioQueueLen) {
+    slot = unqueue(0);
+    emitsDropped++;
+    printf("Offline event queue full, dropping oldest event\n");
+  }
+  if (slot == sioQueueLen) slot = freeSlot();
+
+  QueuedEvent& entry = txQueue[slot];
+  entry.hash = hash;
+  entry.port = port;
+  entry.kind = kind;
+  entry.queuedUs = esp_timer_get_time();
+  entry.len = len;
+  memcpy(entry.frame, frame, len);
+  txOrder[txQueued++] = slot;
+  emitsQueued++;
+}
+
+// Send queued frames oldest first, stopping at the first failure. Holds txLock.
+static void flushQueued() {
+  int64_t now = esp_timer_get_time();
+  while (txQueued > 0) {
+    QueuedEvent& entry = txQueue[txOrder[0]];
+    if (now - entry.queuedUs > (int64_t)sioQueueMaxAgeMs * 1000) emitsDropped++;
+    else if (sendFrame(entry.frame, entry.len)) emitsSent++;
+    else return;
+    unqueue(0);
+  }
+}
+
+// Forget one-shot events that never went out. Holds txLock.
+static void dropOneShots() {
+  for (uint8_t i = 0; i < txQueued;) {
+    if (txQueue[txOrder[i]].kind == EVENT_ONESHOT) {
+      unqueue(i);
+      emitsDropped++;
+    }
+    else i++;
+  }
+}
+
+static void flushEvents() {
+  if (txLock == NULL || xSemaphoreTake(txLock, portMAX_DELAY) != pdTRUE) return;
+  if (txQueued > 0) printf("Replaying %u event(s) emitted while offline\n", txQueued);
+  flushQueued();
+  xSemaphoreGive(txLock);
+}
+
+// Send the finished event, or queue it while offline or while older events
+// are still waiting so the server sees them in order. True if it was sent.
+static bool sendEvent(EventWriter* event) {
+  size_t len = event->finish();
+  bool sent = false;
+  if (len == 0) printf("Socket.IO event too long for tx frame\n");
+  else {
+    if (txQueued == 0) sent = sendFrame(event->frame(), len);
+    if (!sent && txEventKind == EVENT_ONESHOT && !connected) {
+      emitsDropped++;
+      printf("Offline, dropping one-shot event\n");
+    }
+    else if (!sent) {
+      queueFrame(txEventHash, txEventPort, txEventKind, event->frame(), len);
+      flushQueued();
+    }
+  }
+
+  emitTask = NULL;
+  if (sent) emitsSent++;
+  else if (len == 0) emitsFailed++;
+  emitAllocs += allocsInEmit;
+  if (allocsInEmit > emitAllocsMax) emitAllocsMax = allocsInEmit;
+  xSemaphoreGive(txLock);
+  return sent;
 }
 
 // Function to emit 'calib_done' as expected by your server
 void emitCalibDone(int port) {
-  cJSON *data = cJSON_CreateObject();
-  cJSON_AddNumberToObject(data, "port", port);
-  emitSocketEvent("calib_done", data);
+  EventWriter *event = beginEvent("calib_done", port, EVENT_ONESHOT);
+  if (!event) return;
+  sendEvent(event);
 }
 
 // Function to emit 'calib_stage1_ready' to notify server device is ready for tilt up
 void emitCalibStage1Ready(int port) {
-  cJSON *data = cJSON_CreateObject();
-  cJSON_AddNumberToObject(data, "port", port);
-  emitSocketEvent("calib_stage1_ready", data);
+  EventWriter *event = beginEvent("calib_stage1_ready", port, EVENT_ONESHOT);
+  if (!event) return;
+  sendEvent(event);
 }
 
 // Function to emit 'calib_stage2_ready' to notify server device is ready for tilt down
 void emitCalibStage2Ready(int port) {
-  cJSON *data = cJSON_CreateObject();
-  cJSON_AddNumberToObject(data, "port", port);
-  emitSocketEvent("calib_stage2_ready", data);
+  EventWriter *event = beginEvent("calib_stage2_ready", port, EVENT_ONESHOT);
+  if (!event) return;
+  sendEvent(event);
 }
 
 // Function to emit 'report_calib_status' to tell server device's actual calibration state
 void emitCalibStatus(bool calibrated, int port) {
-  cJSON *data = cJSON_CreateObject();
-  cJSON_AddNumberToObject(data, "port", port);
-  cJSON_AddBoolToObject(data, "calibrated", calibrated);
-  emitSocketEvent("report_calib_status", data);
+  EventWriter *event = beginEvent("report_calib_status", port, EVENT_STATE);
+  if (!event) return;
+  event->addBool("calibrated", calibrated);
+  sendEvent(event);
 }
 
 // Function to emit 'device_calib_error' to notify server of calibration failure
 void emitCalibError(const char* errorMessage, int port) {
-  cJSON *data = cJSON_CreateObject();
-  cJSON_AddNumberToObject(data, "port", port);
-  cJSON_AddStringToObject(data, "message", errorMessage);
-  emitSocketEvent("device_calib_error", data);
+  EventWriter *event = beginEvent("device_calib_error", port, EVENT_ONESHOT);
+  if (!event) return;
+  event->addString("message", errorMessage);
+  sendEvent(event);
+}
+
+// Function to emit 'calib_progress' as the automatic sweep finds each end stop
+void emitCalibProgress(const char* stage, int32_t ticks, int port) {
+  EventWriter *event = beginEvent("calib_progress", port, EVENT_ONESHOT);
+  if (!event) return;
+  event->addString("stage", stage).addNumber("ticks", ticks);
+  sendEvent(event);
 }
 
 // Function to emit 'pos_hit' to notify server of position change
-void emitPosHit(int pos, int port) {
-  cJSON *data = cJSON_CreateObject();
-  cJSON_AddNumberToObject(data, "port", port);
-  cJSON_AddNumberToObject(data, "pos", pos);
-  emitSocketEvent("pos_hit", data);
-}
\ No newline at end of file
+bool emitPosHit(int pos, int port) {
+  EventWriter *event = beginEvent("pos_hit", port, EVENT_STATE);
+  if (!event) return false;
+  event->addNumber("pos", pos);
+  return sendEvent(event);
+}
@@ -0,0 +1,61 @@
+// Host stand-in for the ESP-IDF header, used by the native test env only.
+// Pin levels are simulated: tests drive them through hostPins.hpp.
+#ifndef HOST_DRIVER_GPIO_H
+#define HOST_DRIVER_GPIO_H
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef enum {
+  GPIO_NUM_0, GPIO_NUM_1, GPIO_NUM_2, GPIO_NUM_16 = 16, GPIO_NUM_17, GPIO_NUM_20 = 20, GPIO_NUM_22 = 22, GPIO_NUM_23,
+} gpio_num_t;
+
+typedef enum { GPIO_PULLUP_ONLY, GPIO_PULLDOWN_ONLY, GPIO_PULLUP_PULLDOWN, GPIO_FLOATING } gpio_pull_mode_t;
+typedef enum { GPIO_MODE_INPUT = 1 } gpio_mode_t;
+typedef enum { GPIO_PULLUP_DISABLE, GPIO_PULLUP_ENABLE } gpio_pullup_t;
+typedef enum { GPIO_PULLDOWN_DISABLE, GPIO_PULLDOWN_ENABLE } gpio_pulldown_t;
+typedef enum { GPIO_INTR_DISABLE, GPIO_INTR_ANYEDGE = 3 } gpio_int_type_t;
+
+struct gpio_config_t {
+  uint64_t pin_bit_mask;
+  gpio_mode_t mode;
+  gpio_pullup_t pull_up_en;
+  gpio_pulldown_t pull_down_en;
+  gpio_int_type_t intr_type;
+};
+
+#define ESP_INTR_FLAG_LEVEL1 (1 << 1)
+#define ESP_INTR_FLAG_IRAM (1 << 10)
+typedef void* gpio_isr_handle_t;
+
+// Simulated GPIO interrupt: one raw handler, per-pin enables
+inline void (*hostGpioIsr)(void*) = nullptr;
+inline void* hostGpioIsrArg = nullptr;
+inline uint32_t hostGpioIntrMask = 0; // pins with an edge interrupt enabled
+inline uint32_t hostGpioIntrType = 0; // pins set to GPIO_INTR_ANYEDGE
+
+inline esp_err_t gpio_config(const gpio_config_t* config) {
+  if (config->intr_type == GPIO_INTR_DISABLE) hostGpioIntrType &= ~(uint32_t)config->pin_bit_mask;
+  return ESP_OK;
+}
+inline esp_err_t gpio_set_pull_mode(gpio_num_t, gpio_pull_mode_t) { return ESP_OK; }
+inline esp_err_t gpio_set_intr_type(gpio_num_t pin, gpio_int_type_t type) {
+  if (type == GPIO_INTR_ANYEDGE) hostGpioIntrType |= 1UL << pin;
+  else hostGpioIntrType &= ~(1UL << pin);
+  return ESP_OK;
+}
+inline esp_err_t gpio_intr_enable(gpio_num_t pin) {
+  hostGpioIntrMask |= 1UL << pin;
+  return ESP_OK;
+}
+inline esp_err_t gpio_intr_disable(gpio_num_t pin) {
+  hostGpioIntrMask &= ~(1UL << pin);
+  return ESP_OK;
+}
+inline esp_err_t gpio_isr_register(void (*fn)(void*), void* arg, int, gpio_isr_handle_t* handle) {
+  hostGpioIsr = fn;
+  hostGpioIsrArg = arg;
+  *handle = (gpio_isr_handle_t)fn;
+  return ESP_OK;
+}
+
+#endif
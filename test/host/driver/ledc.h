@@ -0,0 +1,7 @@
+// Host stand-in for the ESP-IDF header, used by the native test env only
+#ifndef HOST_DRIVER_LEDC_H
+#define HOST_DRIVER_LEDC_H
+
+typedef enum { LEDC_CHANNEL_0 } ledc_channel_t;
+
+#endif
@@ -0,0 +1,177 @@
+// Host stand-in for the ESP-IDF header, used by the native test env only.
+// A simulated PCNT unit: each channel counts edges on its edge pin by the
+// configured edge and level actions, the count wraps to zero at the limits,
+// and reaching a watch point calls on_reach. Pins are driven through
+// hostPins.hpp.
+#ifndef HOST_DRIVER_PULSE_CNT_H
+#define HOST_DRIVER_PULSE_CNT_H
+#include <stdint.h>
+#include <set>
+#include "esp_err.h"
+
+typedef enum {
+  PCNT_CHANNEL_EDGE_ACTION_HOLD,
+  PCNT_CHANNEL_EDGE_ACTION_INCREASE,
+  PCNT_CHANNEL_EDGE_ACTION_DECREASE,
+} pcnt_channel_edge_action_t;
+typedef enum {
+  PCNT_CHANNEL_LEVEL_ACTION_KEEP,
+  PCNT_CHANNEL_LEVEL_ACTION_INVERSE,
+  PCNT_CHANNEL_LEVEL_ACTION_HOLD,
+} pcnt_channel_level_action_t;
+
+struct pcnt_unit_t;
+struct pcnt_chan_t;
+typedef pcnt_unit_t* pcnt_unit_handle_t;
+typedef pcnt_chan_t* pcnt_channel_handle_t;
+
+typedef struct {
+  int low_limit;
+  int high_limit;
+  int intr_priority;
+  struct {
+    uint32_t accum_count : 1;
+  } flags;
+} pcnt_unit_config_t;
+typedef struct {
+  uint32_t max_glitch_ns;
+} pcnt_glitch_filter_config_t;
+typedef struct {
+  int edge_gpio_num;
+  int level_gpio_num;
+} pcnt_chan_config_t;
+typedef struct {
+  int watch_point_value;
+} pcnt_watch_event_data_t;
+typedef bool (*pcnt_watch_cb_t)(pcnt_unit_handle_t unit, const pcnt_watch_event_data_t* edata, void* user_ctx);
+typedef struct {
+  pcnt_watch_cb_t on_reach;
+} pcnt_event_callbacks_t;
+
+#define HOST_PCNT_UNITS 4
+#define HOST_PCNT_WATCH_POINTS 4 // both limits plus two thresholds, as on the C6
+
+struct pcnt_chan_t {
+  int edgePin;
+  int levelPin;
+  pcnt_channel_edge_action_t posAct, negAct;
+  pcnt_channel_level_action_t highAct, lowAct;
+};
+
+struct pcnt_unit_t {
+  bool used;
+  bool enabled;
+  bool running;
+  int low, high;
+  int count;
+  std::set<int> watch;
+  pcnt_chan_t chans[2];
+  uint8_t chanCount;
+  pcnt_watch_cb_t onReach;
+  void* ctx;
+};
+
+inline pcnt_unit_t hostPcntUnits[HOST_PCNT_UNITS];
+
+inline esp_err_t pcnt_new_unit(const pcnt_unit_config_t* config, pcnt_unit_handle_t* ret) {
+  for (pcnt_unit_t& u : hostPcntUnits) {
+    if (u.used) continue;
+    u = pcnt_unit_t();
+    u.used = true;
+    u.low = config->low_limit;
+    u.high = config->high_limit;
+    *ret = &u;
+    return ESP_OK;
+  }
+  return ESP_ERR_INVALID_STATE;
+}
+inline esp_err_t pcnt_del_unit(pcnt_unit_handle_t unit) {
+  unit->used = false;
+  return ESP_OK;
+}
+inline esp_err_t pcnt_unit_set_glitch_filter(pcnt_unit_handle_t, const pcnt_glitch_filter_config_t*) { return ESP_OK; }
+inline esp_err_t pcnt_new_channel(pcnt_unit_handle_t unit, const pcnt_chan_config_t* config, pcnt_channel_handle_t* ret) {
+  if (unit->chanCount >= 2) return ESP_ERR_INVALID_STATE;
+  pcnt_chan_t& c = unit->chans[unit->chanCount++];
+  c = pcnt_chan_t();
+  c.edgePin = config->edge_gpio_num;
+  c.levelPin = config->level_gpio_num;
+  *ret = &c;
+  return ESP_OK;
+}
+inline esp_err_t pcnt_del_channel(pcnt_channel_handle_t) { return ESP_OK; }
+inline esp_err_t pcnt_channel_set_edge_action(pcnt_channel_handle_t chan, pcnt_channel_edge_action_t pos, pcnt_channel_edge_action_t neg) {
+  chan->posAct = pos;
+  chan->negAct = neg;
+  return ESP_OK;
+}
+inline esp_err_t pcnt_channel_set_level_action(pcnt_channel_handle_t chan, pcnt_channel_level_action_t high, pcnt_channel_level_action_t low) {
+  chan->highAct = high;
+  chan->lowAct = low;
+  return ESP_OK;
+}
+inline esp_err_t pcnt_unit_add_watch_point(pcnt_unit_handle_t unit, int value) {
+  if (value < unit->low || value > unit->high) return ESP_ERR_INVALID_ARG;
+  if (unit->watch.count(value) || unit->watch.size() >= HOST_PCNT_WATCH_POINTS) return ESP_ERR_INVALID_STATE;
+  unit->watch.insert(value);
+  return ESP_OK;
+}
+inline esp_err_t pcnt_unit_remove_watch_point(pcnt_unit_handle_t unit, int value) {
+  return unit->watch.erase(value) ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+inline esp_err_t pcnt_unit_register_event_callbacks(pcnt_unit_handle_t unit, const pcnt_event_callbacks_t* cbs, void* ctx) {
+  unit->onReach = cbs->on_reach;
+  unit->ctx = ctx;
+  return ESP_OK;
+}
+inline esp_err_t pcnt_unit_enable(pcnt_unit_handle_t unit) {
+  unit->enabled = true;
+  return ESP_OK;
+}
+inline esp_err_t pcnt_unit_disable(pcnt_unit_handle_t unit) {
+  unit->enabled = false;
+  return ESP_OK;
+}
+inline esp_err_t pcnt_unit_start(pcnt_unit_handle_t unit) {
+  unit->running = true;
+  return ESP_OK;
+}
+inline esp_err_t pcnt_unit_stop(pcnt_unit_handle_t unit) {
+  unit->running = false;
+  return ESP_OK;
+}
+inline esp_err_t pcnt_unit_clear_count(pcnt_unit_handle_t unit) {
+  unit->count = 0;
+  return ESP_OK;
+}
+inline esp_err_t pcnt_unit_get_count(pcnt_unit_handle_t unit, int* value) {
+  *value = unit->count;
+  return ESP_OK;
+}
+
+// Count one pin change on every running unit
+inline void hostPcntEdges(uint32_t prevLevels, uint32_t levels) {
+  for (pcnt_unit_t& u : hostPcntUnits) {
+    if (!u.used || !u.enabled || !u.running) continue;
+    for (uint8_t i = 0; i < u.chanCount; i++) {
+      const pcnt_chan_t& c = u.chans[i];
+      if (!(((prevLevels ^ levels) >> c.edgePin) & 1)) continue;
+      bool rising = (levels >> c.edgePin) & 1;
+      pcnt_channel_edge_action_t edge = rising ? c.posAct : c.negAct;
+      pcnt_channel_level_action_t level = ((levels >> c.levelPin) & 1) ? c.highAct : c.lowAct;
+      if (edge == PCNT_CHANNEL_EDGE_ACTION_HOLD || level == PCNT_CHANNEL_LEVEL_ACTION_HOLD) continue;
+      int step = edge == PCNT_CHANNEL_EDGE_ACTION_INCREASE ? 1 : -1;
+      if (level == PCNT_CHANNEL_LEVEL_ACTION_INVERSE) step = -step;
+
+      u.count += step;
+      int reached = u.count;
+      if (reached == u.high || reached == u.low) u.count = 0;
+      if (u.watch.count(reached) && u.onReach) {
+        pcnt_watch_event_data_t data = {reached};
+        u.onReach(&u, &data, u.ctx);
+      }
+    }
+  }
+}
+
+#endif
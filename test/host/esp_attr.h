@@ -0,0 +1,9 @@
+// Host stand-in for the ESP-IDF header, used by the native test env only
+#ifndef HOST_ESP_ATTR_H
+#define HOST_ESP_ATTR_H
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_NOINIT_ATTR
+
+#endif
@@ -0,0 +1,8 @@
+// Host stand-in for the ESP-IDF header, used by the native test env only
+#ifndef HOST_ESP_CPU_H
+#define HOST_ESP_CPU_H
+#include <stdint.h>
+
+inline uint32_t esp_cpu_get_cycle_count() { return 0; }
+
+#endif
@@ -0,0 +1,10 @@
+// Host stand-in for the ESP-IDF header, used by the native test env only.
+// Time is simulated: tests advance hostTimeUs themselves.
+#ifndef HOST_ESP_TIMER_H
+#define HOST_ESP_TIMER_H
+#include <stdint.h>
+
+inline int64_t hostTimeUs = 0;
+inline int64_t esp_timer_get_time() { return hostTimeUs; }
+
+#endif
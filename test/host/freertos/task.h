@@ -0,0 +1,6 @@
+// Host stand-in for the ESP-IDF header, used by the native test env only
+#ifndef HOST_FREERTOS_TASK_H
+#define HOST_FREERTOS_TASK_H
+#include "FreeRTOS.h"
+
+#endif
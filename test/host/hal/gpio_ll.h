@@ -0,0 +1,8 @@
+// Host stand-in for the ESP-IDF header, used by the native test env only
+#ifndef HOST_HAL_GPIO_LL_H
+#define HOST_HAL_GPIO_LL_H
+#include "soc/gpio_struct.h"
+
+inline void gpio_ll_clear_intr_status(gpio_dev_t* hw, uint32_t mask) { hw->status &= ~mask; }
+
+#endif
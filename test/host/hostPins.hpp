@@ -0,0 +1,38 @@
+// Drives the simulated GPIO input levels for host tests: each change is
+// counted by the running PCNT units and, on pins with an edge interrupt
+// enabled, runs the registered GPIO ISR, as the hardware would.
+#ifndef HOST_PINS_HPP
+#define HOST_PINS_HPP
+#include <stdint.h>
+#include "driver/gpio.h"
+#include "driver/pulse_cnt.h"
+#include "soc/gpio_struct.h"
+
+inline void hostSetPins(uint32_t levels) {
+  uint32_t prev = GPIO.in.val;
+  if (levels == prev) return;
+  GPIO.in.val = levels;
+  hostPcntEdges(prev, levels);
+  uint32_t edges = (prev ^ levels) & hostGpioIntrMask & hostGpioIntrType;
+  GPIO.status |= edges;
+  if (edges && hostGpioIsr) hostGpioIsr(hostGpioIsrArg);
+}
+
+// Quadrature source on two pins: step(+1/-1) moves one quarter step,
+// with A leading B going up (the quadTable convention)
+struct HostQuadrature {
+  gpio_num_t pinA;
+  gpio_num_t pinB;
+  int32_t quarters = 0; // quarter steps taken from the start
+
+  void step(int8_t dir) {
+    static const uint8_t phases[4] = {0b00, 0b10, 0b11, 0b01}; // AB
+    quarters += dir;
+    uint8_t ab = phases[quarters & 3];
+    uint32_t mask = (1UL << pinA) | (1UL << pinB);
+    uint32_t levels = (GPIO.in.val & ~mask) | ((uint32_t)(ab >> 1) << pinA) | ((uint32_t)(ab & 1) << pinB);
+    hostSetPins(levels);
+  }
+};
+
+#endif
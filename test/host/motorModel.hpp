@@ -0,0 +1,81 @@
+// Simulated servo and motor encoder for the native test env.
+// The duty offset from offSpeed sets a target speed through a deadband and
+// a gain, reached with a first-order lag. End stops pin the position, and
+// the speed estimate mirrors Encoder: a 1/4-weight IIR on detent intervals,
+// bounded by one tick over the time since the last detent.
+#ifndef HOST_MOTOR_MODEL_H
+#define HOST_MOTOR_MODEL_H
+#include <math.h>
+#include <stdint.h>
+#include "esp_timer.h"
+
+struct MotorModel {
+  float gain = 1.0f / 35.0f; // ticks/s per duty past the deadband
+  float deadband = 100;      // duty that doesn't turn the servo
+  float tauS = 0.08f;        // speed lag
+  float lowStop = -1e9f;     // end stops, ticks
+  float highStop = 1e9f;
+  bool jammed = false;       // motor stopped dead regardless of duty
+  bool ownsClock = true;     // false for a second model stepped alongside
+
+  int32_t duty = 0;
+  float pos = 0;
+  float vel = 0;
+
+  // Encoder side
+  int32_t lastCount = 0;
+  uint32_t lastEdgeUs = 0;
+  uint32_t edgePeriodUs = 0; // between the last two detents, 0 until there are two
+  bool anyEdge = false;
+  int32_t velEstimate = 0; // milli-ticks/s
+
+  void place(float p) {
+    pos = p;
+    vel = 0;
+    lastCount = count();
+  }
+
+  int32_t count() const { return (int32_t)floorf(pos); }
+
+  // Advance the model by dtUs and, unless it shares the clock, the simulated clock with it
+  void step(uint32_t dtUs) {
+    if (ownsClock) hostTimeUs += dtUs;
+    float dt = dtUs / 1e6f;
+    float drive = fabsf((float)duty) <= deadband ? 0 : (duty - (duty > 0 ? deadband : -deadband)) * gain;
+    if (jammed) drive = 0;
+    vel += (drive - vel) * (1 - expf(-dt / tauS));
+    if (jammed) vel = 0;
+    pos += vel * dt;
+    if (pos >= highStop) { pos = highStop; vel = fminf(vel, 0); }
+    if (pos <= lowStop) { pos = lowStop; vel = fmaxf(vel, 0); }
+
+    int32_t c = count();
+    if (c != lastCount) {
+      uint32_t now = (uint32_t)hostTimeUs;
+      if (anyEdge && now != lastEdgeUs) {
+        int32_t inst = (int32_t)((int64_t)(c - lastCount) * 1000000000LL / (now - lastEdgeUs));
+        int32_t prev = bound(velEstimate, now - lastEdgeUs);
+        velEstimate = prev + (inst - prev) / 4;
+        edgePeriodUs = now - lastEdgeUs;
+      }
+      anyEdge = true;
+      lastCount = c;
+      lastEdgeUs = now;
+    }
+  }
+
+  // Encoder::getVelocity equivalent, milli-ticks/s
+  int32_t velocity() const {
+    if (!anyEdge) return 0;
+    return bound(velEstimate, (uint32_t)hostTimeUs - lastEdgeUs);
+  }
+
+private:
+  static int32_t bound(int32_t v, uint32_t sinceUs) {
+    if (sinceUs == 0) return v;
+    int32_t b = (int32_t)(1000000000LL / sinceUs);
+    return v > b ? b : (v < -b ? -b : v);
+  }
+};
+
+#endif
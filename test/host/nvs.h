@@ -0,0 +1,54 @@
+// Host stand-in for the ESP-IDF header, used by the native test env only.
+// Keys live in memory per namespace; commit is a no-op and tests can wipe
+// everything with hostNvsErase().
+#ifndef HOST_NVS_H
+#define HOST_NVS_H
+#include <stdint.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "esp_err.h"
+
+typedef uint32_t nvs_handle_t;
+typedef enum { NVS_READONLY, NVS_READWRITE } nvs_open_mode_t;
+
+typedef std::map<std::string, std::vector<uint8_t>> HostNvsSpace;
+inline std::map<std::string, HostNvsSpace> hostNvs;
+inline std::vector<std::string> hostNvsHandles; // handle - 1 -> namespace
+
+inline void hostNvsErase() { hostNvs.clear(); }
+
+inline esp_err_t nvs_open(const char* ns, nvs_open_mode_t mode, nvs_handle_t* handle) {
+  if (mode == NVS_READONLY && !hostNvs.count(ns)) return ESP_ERR_NVS_NOT_FOUND;
+  hostNvs[ns];
+  hostNvsHandles.push_back(ns);
+  *handle = hostNvsHandles.size();
+  return ESP_OK;
+}
+inline void nvs_close(nvs_handle_t) {}
+inline esp_err_t nvs_commit(nvs_handle_t) { return ESP_OK; }
+
+inline esp_err_t hostNvsSet(nvs_handle_t handle, const char* key, const void* value, size_t len) {
+  const uint8_t* bytes = (const uint8_t*)value;
+  hostNvs[hostNvsHandles[handle - 1]][key].assign(bytes, bytes + len);
+  return ESP_OK;
+}
+inline esp_err_t hostNvsGet(nvs_handle_t handle, const char* key, void* value, size_t* len) {
+  HostNvsSpace& space = hostNvs[hostNvsHandles[handle - 1]];
+  auto it = space.find(key);
+  if (it == space.end()) return ESP_ERR_NVS_NOT_FOUND;
+  if (*len < it->second.size()) return ESP_ERR_INVALID_SIZE;
+  *len = it->second.size();
+  memcpy(value, it->second.data(), *len);
+  return ESP_OK;
+}
+
+inline esp_err_t nvs_set_i32(nvs_handle_t h, const char* key, int32_t v) { return hostNvsSet(h, key, &v, sizeof(v)); }
+inline esp_err_t nvs_set_u8(nvs_handle_t h, const char* key, uint8_t v) { return hostNvsSet(h, key, &v, sizeof(v)); }
+inline esp_err_t nvs_set_blob(nvs_handle_t h, const char* key, const void* v, size_t len) { return hostNvsSet(h, key, v, len); }
+inline esp_err_t nvs_get_i32(nvs_handle_t h, const char* key, int32_t* v) { size_t len = sizeof(*v); return hostNvsGet(h, key, v, &len); }
+inline esp_err_t nvs_get_u8(nvs_handle_t h, const char* key, uint8_t* v) { size_t len = sizeof(*v); return hostNvsGet(h, key, v, &len); }
+inline esp_err_t nvs_get_blob(nvs_handle_t h, const char* key, void* v, size_t* len) { return hostNvsGet(h, key, v, len); }
+
+#endif
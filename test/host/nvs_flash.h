@@ -0,0 +1,6 @@
+// Host stand-in for the ESP-IDF header, used by the native test env only
+#ifndef HOST_NVS_FLASH_H
+#define HOST_NVS_FLASH_H
+#include "nvs.h"
+
+#endif
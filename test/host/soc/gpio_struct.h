@@ -0,0 +1,14 @@
+// Host stand-in for the ESP-IDF header, used by the native test env only
+#ifndef HOST_SOC_GPIO_STRUCT_H
+#define HOST_SOC_GPIO_STRUCT_H
+#include <stdint.h>
+
+struct gpio_dev_t {
+  struct {
+    uint32_t val;
+  } in;
+  uint32_t status; // pending edge interrupts
+};
+inline gpio_dev_t GPIO = {};
+
+#endif
@@ -0,0 +1,170 @@
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "calibration.hpp"
+#include "defines.h"
+
+// Conversions between app positions and encoder ticks through the position
+// curve, for ranges in both directions and curves with uneven segments.
+// NVS is the in-memory host stand-in, wiped before each test.
+
+static const uint16_t linearCurve[curveKnots] = {0, 100, 200, 300, 400, 500, 600, 700, 800, 900, 1000};
+static const uint16_t easedCurve[curveKnots] = {0, 20, 60, 120, 200, 300, 420, 560, 720, 880, 1000};
+static const uint16_t flatCurve[curveKnots] = {0, 150, 300, 300, 300, 450, 600, 750, 900, 950, 1000};
+
+struct Range {
+  int32_t up;
+  int32_t down;
+};
+static const Range ranges[] = {{0, 400}, {400, 0}, {-1000, -200}, {250, -250}, {3, 13}, {-7, -37}};
+
+static void calibrate(Calibration& calib, const Range& r, const uint16_t* curve) {
+  calib.init();
+  TEST_ASSERT_TRUE(calib.beginDownwardCalib(r.up));
+  TEST_ASSERT_TRUE(calib.completeCalib(r.down));
+  TEST_ASSERT_TRUE(calib.saveCurve(curve));
+}
+
+void setUp() {
+  hostNvsErase();
+}
+void tearDown() {}
+
+void test_ends_map_to_range() {
+  for (const Range& r : ranges) {
+    Calibration calib("calibTest");
+    calibrate(calib, r, easedCurve);
+    char msg[48];
+    snprintf(msg, sizeof(msg), "range %d - %d", r.up, r.down);
+    TEST_ASSERT_EQUAL_INT32_MESSAGE(r.down, calib.convertToTicks(0), msg);
+    TEST_ASSERT_EQUAL_INT32_MESSAGE(r.up, calib.convertToTicks(posResolution), msg);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, calib.convertToAppPos(r.down), msg);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(posResolution, calib.convertToAppPos(r.up), msg);
+    // past either end clamps
+    int8_t dir = r.up > r.down ? 1 : -1;
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, calib.convertToAppPos(r.down - dir * 50), msg);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(posResolution, calib.convertToAppPos(r.up + dir * 50), msg);
+  }
+}
+
+// Every app position survives app -> ticks -> app unless it shares its
+// tick with a neighbour (small ranges, shallow curve segments)
+void test_app_position_round_trip() {
+  const uint16_t* curves[] = {linearCurve, easedCurve};
+  for (const uint16_t* curve : curves) {
+    for (const Range& r : ranges) {
+      Calibration calib("calibTest");
+      calibrate(calib, r, curve);
+      for (uint16_t p = 0; p <= posResolution; p++) {
+        int32_t t = calib.convertToTicks(p);
+        // positions that round to the same tick can't be told apart
+        if ((p > 0 && calib.convertToTicks(p - 1) == t) || (p < posResolution && calib.convertToTicks(p + 1) == t)) continue;
+        char msg[64];
+        snprintf(msg, sizeof(msg), "range %d - %d, app position %u", r.up, r.down, p);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(p, calib.convertToAppPos(t), msg);
+      }
+    }
+  }
+}
+
+// Walking the range tick by tick never moves the app position backwards,
+// and every tick maps to the position whose ticks are nearest
+void test_ticks_monotone_and_nearest() {
+  const uint16_t* curves[] = {linearCurve, easedCurve, flatCurve};
+  for (const uint16_t* curve : curves) {
+    for (const Range& r : ranges) {
+      Calibration calib("calibTest");
+      calibrate(calib, r, curve);
+      int8_t dir = r.up > r.down ? 1 : -1;
+      uint16_t prev = 0;
+      for (int32_t t = r.down; t != r.up + dir; t += dir) {
+        uint16_t p = calib.convertToAppPos(t);
+        char msg[80];
+        snprintf(msg, sizeof(msg), "range %d - %d, tick %d -> %u after %u", r.up, r.down, t, p, prev);
+        TEST_ASSERT_TRUE_MESSAGE(p >= prev, msg);
+        // the nearest position's ticks are no further away than the neighbours'
+        int32_t err = abs(calib.convertToTicks(p) - t);
+        if (p > 0) TEST_ASSERT_LESS_OR_EQUAL_MESSAGE(abs(calib.convertToTicks(p - 1) - t), err, msg);
+        if (p < posResolution) TEST_ASSERT_LESS_OR_EQUAL_MESSAGE(abs(calib.convertToTicks(p + 1) - t), err, msg);
+        prev = p;
+      }
+    }
+  }
+}
+
+// A saved curve comes back from NVS on the next boot
+void test_curve_persists() {
+  Range r = {-300, 500};
+  Calibration before("calibTest");
+  calibrate(before, r, easedCurve);
+  Calibration after("calibTest");
+  after.init();
+  TEST_ASSERT_TRUE(after.getCalibrated());
+  for (uint16_t p = 0; p <= posResolution; p++)
+    TEST_ASSERT_EQUAL_INT32(before.convertToTicks(p), after.convertToTicks(p));
+}
+
+// Gains tuned by the calibration sweep come back on the next boot, and
+// completing a later calibration keeps them
+void test_gains_persist() {
+  Calibration before("calibTest");
+  calibrate(before, {0, 400}, linearCurve);
+  PIDGains tuned = before.gains;
+  tuned.kf = 42.5f;
+  TEST_ASSERT_TRUE(before.saveGains(tuned));
+  Calibration after("calibTest");
+  after.init();
+  TEST_ASSERT_EQUAL_INT32(42500, (int32_t)(after.gains.kf * 1000));
+  TEST_ASSERT_EQUAL_INT32((int32_t)(defaultKp * 1000), (int32_t)(after.gains.kp * 1000));
+  calibrate(after, {-100, 300}, linearCurve);
+  Calibration again("calibTest");
+  again.init();
+  TEST_ASSERT_EQUAL_INT32(42500, (int32_t)(again.gains.kf * 1000));
+}
+
+// Invalid curves are rejected and leave the mapping as it was
+void test_invalid_curve_rejected() {
+  static const uint16_t notRising[curveKnots] = {0, 100, 200, 300, 250, 500, 600, 700, 800, 900, 1000};
+  static const uint16_t badStart[curveKnots] = {10, 100, 200, 300, 400, 500, 600, 700, 800, 900, 1000};
+  static const uint16_t badEnd[curveKnots] = {0, 100, 200, 300, 400, 500, 600, 700, 800, 900, 999};
+  Calibration calib("calibTest");
+  calibrate(calib, {0, 400}, easedCurve);
+  int32_t ticks[posResolution + 1];
+  for (uint16_t p = 0; p <= posResolution; p++) ticks[p] = calib.convertToTicks(p);
+
+  const uint16_t* bad[] = {notRising, badStart, badEnd};
+  for (const uint16_t* curve : bad) {
+    TEST_ASSERT_FALSE(calib.saveCurve(curve));
+    for (uint16_t p = 0; p <= posResolution; p++) TEST_ASSERT_EQUAL_INT32(ticks[p], calib.convertToTicks(p));
+  }
+  Calibration reloaded("calibTest");
+  reloaded.init();
+  for (uint16_t p = 0; p <= posResolution; p++) TEST_ASSERT_EQUAL_INT32(ticks[p], reloaded.convertToTicks(p));
+}
+
+// Knots as the server sends them: anything outside 0..1000 is rejected
+// rather than wrapped into range, as are curves that fall back
+void test_server_knots_checked() {
+  const int32_t good[curveKnots] = {0, 20, 60, 120, 200, 300, 420, 560, 720, 880, 1000};
+  const int32_t wraps[curveKnots] = {65536, 100, 200, 300, 400, 500, 600, 700, 800, 900, 1000};
+  const int32_t negative[curveKnots] = {0, -100, 200, 300, 400, 500, 600, 700, 800, 900, 1000};
+  const int32_t tooHigh[curveKnots] = {0, 100, 200, 300, 400, 500, 600, 700, 800, 66436, 1000};
+  const int32_t falls[curveKnots] = {0, 100, 200, 300, 250, 500, 600, 700, 800, 900, 1000};
+  uint16_t knots[curveKnots];
+  TEST_ASSERT_TRUE(Calibration::curveFromKnots(good, knots));
+  for (int i = 0; i < curveKnots; i++) TEST_ASSERT_EQUAL_INT(easedCurve[i], knots[i]);
+  const int32_t* bad[] = {wraps, negative, tooHigh, falls};
+  for (const int32_t* values : bad) TEST_ASSERT_FALSE(Calibration::curveFromKnots(values, knots));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_ends_map_to_range);
+  RUN_TEST(test_app_position_round_trip);
+  RUN_TEST(test_ticks_monotone_and_nearest);
+  RUN_TEST(test_curve_persists);
+  RUN_TEST(test_gains_persist);
+  RUN_TEST(test_invalid_curve_rejected);
+  RUN_TEST(test_server_knots_checked);
+  return UNITY_END();
+}
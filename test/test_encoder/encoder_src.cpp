@@ -0,0 +1,4 @@
+// The encoder backends need motionPostFromISR, which only this test
+// defines, so they are compiled here rather than in every native test
+// program. The host drivers under test/host stand in for the hardware.
+#include "../../src/encoder.cpp"
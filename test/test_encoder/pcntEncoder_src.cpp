@@ -0,0 +1,2 @@
+// See encoder_src.cpp
+#include "../../src/pcntEncoder.cpp"
@@ -0,0 +1,310 @@
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+#include "encoder.hpp"
+#include "pcntEncoder.hpp"
+#include "hostPins.hpp"
+
+// GpioEncoder and PcntEncoder on the same two pins, fed the same edge
+// streams through the simulated GPIO interrupt and PCNT unit. They must
+// agree on the count after every edge and report a watched count at the
+// same edge, including across the PCNT limit wraps into rawBase.
+
+static PinnedEncoder<GPIO_NUM_16, GPIO_NUM_17> gpioEnc;
+static PcntEncoder pcntEnc(GPIO_NUM_16, GPIO_NUM_17);
+static HostQuadrature quad = {GPIO_NUM_16, GPIO_NUM_17};
+
+struct Posted {
+  uint8_t id;
+  int32_t count;
+};
+static std::vector<Posted> posted;
+
+static uint32_t benchPosts = 0;
+
+void motionPostFromISR(uint8_t id, int32_t count) {
+  if (id >= MAX_ENCODERS) benchPosts++; // unregistered benchmark decoders
+  else posted.push_back({id, count});
+}
+
+// Edge index at which each backend first reported the target, and the
+// first edge after which the counts differed; -1 if never
+struct Hits {
+  long gpio = -1;
+  long pcnt = -1;
+  long mismatch = -1;
+};
+
+// Step through the stream, draining events after each edge the way the
+// motion task does: the listener re-arms the PCNT watch on every event.
+static Hits replay(const std::vector<int8_t>& steps, int32_t target) {
+  Hits hits;
+  pcntEnc.setWatch(target);
+  for (size_t i = 0; i < steps.size(); i++) {
+    quad.step(steps[i]);
+    bool rearm = false;
+    for (const Posted& p : posted) {
+      if (p.id == gpioEnc.id && p.count == target && hits.gpio < 0) hits.gpio = (long)i;
+      if (p.id == pcntEnc.id) {
+        if (p.count == target && hits.pcnt < 0) hits.pcnt = (long)i;
+        rearm = true;
+      }
+    }
+    posted.clear();
+    if (rearm) pcntEnc.setWatch(target);
+
+    if (gpioEnc.getCount() != pcntEnc.getCount() && hits.mismatch < 0) hits.mismatch = (long)i;
+  }
+  return hits;
+}
+
+// Walk toward the target detent with some jitter, then overshoot by a few
+// detents and settle back, ending on a whole detent
+static std::vector<int8_t> walk(int32_t from, int32_t to, unsigned seed) {
+  std::vector<int8_t> steps;
+  srand(seed);
+  int8_t dir = to > from ? 1 : -1;
+  int32_t quarters = from * 4, goal = (to + 3 * dir) * 4;
+  while (quarters != goal) {
+    int8_t s = (rand() % 8 == 0) ? -dir : dir; // contact bounce and hand jitter
+    quarters += s;
+    steps.push_back(s);
+  }
+  while (quarters != to * 4) {
+    quarters -= dir;
+    steps.push_back(-dir);
+  }
+  return steps;
+}
+
+static void checkMove(int32_t to, unsigned seed) {
+  int32_t from = gpioEnc.getCount();
+  Hits hits = replay(walk(from, to, seed), to);
+  char msg[64];
+  snprintf(msg, sizeof(msg), "move %d -> %d", from, to);
+  TEST_ASSERT_EQUAL_INT_MESSAGE(-1, hits.mismatch, msg);
+  TEST_ASSERT_TRUE_MESSAGE(hits.gpio >= 0, msg);
+  TEST_ASSERT_EQUAL_INT_MESSAGE(hits.gpio, hits.pcnt, msg);
+  TEST_ASSERT_EQUAL_INT32_MESSAGE(to, pcntEnc.getCount(), msg);
+}
+
+void setUp() {
+  static bool initialized = false;
+  if (initialized) return;
+  gpioEnc.init();
+  pcntEnc.init();
+  initialized = true;
+}
+void tearDown() {}
+
+void test_short_moves() {
+  checkMove(20, 1);
+  checkMove(-15, 2);
+  checkMove(-14, 3); // one detent up
+  checkMove(-15, 4); // and back down
+  checkMove(3, 5);
+}
+
+// Long moves leave the PCNT window (+-32000 quarter steps): the watch is
+// too far to arm until the limit wrap accumulates into rawBase and re-runs
+// the listener
+void test_moves_across_limit_wraps() {
+  checkMove(8500, 6);
+  checkMove(-8200, 7);
+  checkMove(17000, 8);
+  checkMove(0, 9);
+}
+
+// setCount on a whole detent rebases both backends the same way
+void test_set_count() {
+  checkMove(40, 10);
+  gpioEnc.setCount(1000);
+  pcntEnc.setCount(1000);
+  checkMove(970, 11);
+  checkMove(9200, 12);
+}
+
+// Neither backend ever counts illegal transitions here
+void test_no_decode_errors() {
+  TEST_ASSERT_EQUAL_UINT32(0, gpioEnc.getErrors());
+}
+
+// One port's motor (pins 16/17) and wand (22/23) encoders moving together,
+// recorded as the GPIO.in word after each edge, out and back
+static std::vector<uint32_t> recordTrace(size_t edges) {
+  static const uint8_t phases[4] = {0b00, 0b10, 0b11, 0b01};
+  std::vector<uint32_t> trace;
+  srand(42);
+  int32_t motor = 0, wand = 0;
+  int8_t motorDir = 1;
+  uint32_t levels = 0;
+  while (trace.size() < edges) {
+    if (rand() % 3) {
+      if (rand() % 2000 == 0) motorDir = -motorDir;
+      motor += motorDir;
+      uint8_t ab = phases[motor & 3];
+      levels = (levels & ~((1UL << 16) | (1UL << 17))) | ((uint32_t)(ab >> 1) << 16) | ((uint32_t)(ab & 1) << 17);
+    }
+    else {
+      wand += (rand() % 4) ? 1 : -1;
+      uint8_t ab = phases[wand & 3];
+      levels = (levels & ~((1UL << 22) | (1UL << 23))) | ((uint32_t)(ab >> 1) << 22) | ((uint32_t)(ab & 1) << 23);
+    }
+    trace.push_back(levels);
+  }
+  // and back, so the trace can be replayed in a loop
+  for (size_t i = trace.size() - 1; i-- > 0;) trace.push_back(trace[i]);
+  trace.push_back(0);
+  return trace;
+}
+
+// The dispatch bank_isr replaced: the IDF GPIO ISR service calls one
+// handler per pending pin, and each handler reads GPIO.in and decodes its
+// encoder with the pin numbers held in the instance
+struct PinDecoder {
+  uint8_t pinA, pinB;
+  uint8_t lastAB;
+  int8_t base;
+  std::atomic<int32_t> count; // shared with tasks, as in GpioEncoder
+};
+static uint32_t perPinLevels; // GPIO.in as the handlers read it
+
+static void perPinHandler(void* arg) {
+  PinDecoder* d = static_cast<PinDecoder*>(arg);
+  uint32_t levels = perPinLevels;
+  uint8_t ab = (uint8_t)((((levels >> d->pinA) & 0x1) << 1) | ((levels >> d->pinB) & 0x1));
+  int8_t quarter = quadTable[(d->lastAB << 2) | ab];
+  d->lastAB = ab;
+  if (quarter == QUAD_ERR) return;
+  d->base += quarter;
+  int8_t detent = 0;
+  if (d->base >= 4) {
+    detent = 1;
+    d->base -= 4;
+  }
+  else if (d->base < 0) {
+    detent = -1;
+    d->base += 4;
+  }
+  if (detent) motionPostFromISR(MAX_ENCODERS, d->count.fetch_add(detent) + detent);
+}
+
+struct PinHandler {
+  void (*fn)(void*);
+  void* arg;
+};
+
+static void perPinDispatch(const PinHandler* handlers, uint32_t status) {
+  while (status) {
+    uint32_t pin = __builtin_ctz(status);
+    handlers[pin].fn(handlers[pin].arg);
+    status &= status - 1;
+  }
+}
+
+// GpioEncoder decoding with the pin numbers it holds at run time, as it
+// did before PinnedEncoder: the comparison point for the template
+class RuntimePinEncoder : public GpioEncoder {
+public:
+  RuntimePinEncoder(gpio_num_t pinA, gpio_num_t pinB) : GpioEncoder(pinA, pinB, GPIO_PULLUP_ONLY, &decode) {}
+
+private:
+  static void decode(GpioEncoder* encoder, uint32_t prevLevels, uint32_t levels) {
+    uint32_t prev = (((prevLevels >> encoder->pin_a) & 0x1) << 1) | ((prevLevels >> encoder->pin_b) & 0x1);
+    uint32_t current = (((levels >> encoder->pin_a) & 0x1) << 1) | ((levels >> encoder->pin_b) & 0x1);
+    static_cast<RuntimePinEncoder*>(encoder)->step<4>((prev << 2) | current);
+  }
+};
+
+// ns per edge for a bank replaying the trace rounds times
+static double timeBank(GpioEncoder* const* bank, const std::vector<uint32_t>& trace, int rounds) {
+  const uint32_t pinMask = (1UL << 16) | (1UL << 17) | (1UL << 22) | (1UL << 23);
+  uint32_t prev = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; r++) {
+    for (uint32_t levels : trace) {
+      GpioEncoder::decodeBank(bank, 2, pinMask, prev, levels);
+      prev = levels;
+    }
+  }
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / (rounds * trace.size());
+}
+
+// Bank decode and per-pin dispatch over the same trace: equal counts, and
+// the time per edge on this host (the target figure is isrMaxCycles)
+void test_bank_decode_benchmark() {
+  const int rounds = 20;
+  std::vector<uint32_t> trace = recordTrace(100000);
+  const size_t edges = trace.size();
+  const uint32_t pinMask = (1UL << 16) | (1UL << 17) | (1UL << 22) | (1UL << 23);
+
+  PinnedEncoder<GPIO_NUM_16, GPIO_NUM_17> motor;
+  PinnedEncoder<GPIO_NUM_22, GPIO_NUM_23> wand;
+  GpioEncoder* bank[] = {&motor, &wand};
+  benchPosts = 0;
+  double bankNs = timeBank(bank, trace, rounds);
+  uint32_t bankPosts = benchPosts;
+
+  PinDecoder motorPins = {16, 17, 0, 0, {0}}, wandPins = {22, 23, 0, 0, {0}};
+  PinHandler handlers[32] = {};
+  handlers[16] = handlers[17] = {perPinHandler, &motorPins};
+  handlers[22] = handlers[23] = {perPinHandler, &wandPins};
+  benchPosts = 0;
+  uint32_t prev = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; r++) {
+    for (uint32_t levels : trace) {
+      perPinLevels = levels;
+      perPinDispatch(handlers, (levels ^ prev) & pinMask);
+      prev = levels;
+    }
+  }
+  double pinNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / (rounds * edges);
+
+  TEST_ASSERT_EQUAL_INT32(motorPins.count.load(), motor.getCount());
+  TEST_ASSERT_EQUAL_INT32(wandPins.count.load(), wand.getCount());
+  TEST_ASSERT_EQUAL_UINT32(bankPosts, benchPosts);
+  TEST_ASSERT_EQUAL_UINT32(0, motor.getErrors() + wand.getErrors());
+  char msg[96];
+  snprintf(msg, sizeof(msg), "bank decode %.2f ns per edge, per-pin dispatch %.2f ns per edge on this host", bankNs, pinNs);
+  TEST_MESSAGE(msg);
+}
+
+// PinnedEncoder against the runtime-pin decoder it replaced, on the same
+// trace through the same bank decode
+void test_pinned_decode_benchmark() {
+  const int rounds = 20;
+  std::vector<uint32_t> trace = recordTrace(100000);
+
+  PinnedEncoder<GPIO_NUM_16, GPIO_NUM_17> pinnedMotor;
+  PinnedEncoder<GPIO_NUM_22, GPIO_NUM_23> pinnedWand;
+  GpioEncoder* pinned[] = {&pinnedMotor, &pinnedWand};
+  RuntimePinEncoder runtimeMotor(GPIO_NUM_16, GPIO_NUM_17);
+  RuntimePinEncoder runtimeWand(GPIO_NUM_22, GPIO_NUM_23);
+  GpioEncoder* runtime[] = {&runtimeMotor, &runtimeWand};
+
+  // alternate so neither always runs on a cold or warm cache
+  double pinnedNs = 0, runtimeNs = 0;
+  for (int i = 0; i < 3; i++) {
+    pinnedNs += timeBank(pinned, trace, rounds) / 3;
+    runtimeNs += timeBank(runtime, trace, rounds) / 3;
+  }
+  TEST_ASSERT_EQUAL_INT32(runtimeMotor.getCount(), pinnedMotor.getCount());
+  TEST_ASSERT_EQUAL_INT32(runtimeWand.getCount(), pinnedWand.getCount());
+  char msg[96];
+  snprintf(msg, sizeof(msg), "pinned %.2f ns per edge, runtime pins %.2f ns per edge on this host", pinnedNs, runtimeNs);
+  TEST_MESSAGE(msg);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_short_moves);
+  RUN_TEST(test_moves_across_limit_wraps);
+  RUN_TEST(test_set_count);
+  RUN_TEST(test_no_decode_errors);
+  RUN_TEST(test_bank_decode_benchmark);
+  RUN_TEST(test_pinned_decode_benchmark);
+  return UNITY_END();
+}
@@ -0,0 +1,4 @@
+// cJSON is fetched by lib_deps but kept out of the library build, whose
+// own test programs bring a main(). Only the library itself is compiled,
+// as the reference for EventWriter.
+#include "cJSON.c"
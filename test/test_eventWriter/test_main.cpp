@@ -0,0 +1,160 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "cJSON.h"
+#include "eventWriter.hpp"
+
+// EventWriter's JSON must match cJSON_PrintUnformatted byte for byte, since
+// the server saw cJSON's output before. Each case builds the same event both
+// ways and compares.
+
+enum FieldType { NUMBER, BOOL, STRING };
+struct Field {
+  FieldType type;
+  const char* key;
+  int32_t number;
+  const char* text;
+};
+
+static void checkEvent(const char* name, const Field* fields, int count) {
+  char frame[512];
+  EventWriter writer(frame, sizeof(frame), name);
+  cJSON* array = cJSON_CreateArray();
+  cJSON_AddItemToArray(array, cJSON_CreateString(name));
+  cJSON* data = cJSON_CreateObject();
+  for (int i = 0; i < count; i++) {
+    const Field& f = fields[i];
+    switch (f.type) {
+      case NUMBER:
+        writer.addNumber(f.key, f.number);
+        cJSON_AddNumberToObject(data, f.key, f.number);
+        break;
+      case BOOL:
+        writer.addBool(f.key, f.number != 0);
+        cJSON_AddBoolToObject(data, f.key, f.number != 0);
+        break;
+      case STRING:
+        writer.addString(f.key, f.text);
+        cJSON_AddStringToObject(data, f.key, f.text);
+        break;
+    }
+  }
+  cJSON_AddItemToArray(array, data);
+  char* expected = cJSON_PrintUnformatted(array);
+
+  size_t len = writer.finish();
+  TEST_ASSERT_TRUE_MESSAGE(len > 0, name);
+  TEST_ASSERT_EQUAL_INT_MESSAGE(strlen(frame), len, name);
+  TEST_ASSERT_EQUAL_MEMORY_MESSAGE("42", writer.frame(), 2, name);
+  TEST_ASSERT_EQUAL_STRING_MESSAGE(expected, writer.json(), name);
+  cJSON_free(expected);
+  cJSON_Delete(array);
+}
+
+void setUp() {}
+void tearDown() {}
+
+// Every event the firmware sends, as socketIO.cpp builds them
+void test_firmware_events() {
+  const Field port[] = {{NUMBER, "port", 1, nullptr}};
+  checkEvent("calib_done", port, 1);
+  checkEvent("calib_stage1_ready", port, 1);
+  checkEvent("calib_stage2_ready", port, 1);
+  const Field status[] = {{NUMBER, "port", 2, nullptr}, {BOOL, "calibrated", 1, nullptr}};
+  checkEvent("report_calib_status", status, 2);
+  const Field notCalibrated[] = {{NUMBER, "port", 2, nullptr}, {BOOL, "calibrated", 0, nullptr}};
+  checkEvent("report_calib_status", notCalibrated, 2);
+  const Field error[] = {{NUMBER, "port", 1, nullptr}, {STRING, "message", 0, "Direction Switch Failed"}};
+  checkEvent("device_calib_error", error, 2);
+  const Field progress[] = {{NUMBER, "port", 1, nullptr}, {STRING, "stage", 0, "end_up"}, {NUMBER, "ticks", -1234, nullptr}};
+  checkEvent("calib_progress", progress, 3);
+  const Field pos[] = {{NUMBER, "port", 1, nullptr}, {NUMBER, "pos", 7, nullptr}};
+  checkEvent("pos_hit", pos, 2);
+}
+
+void test_number_edges() {
+  const int32_t values[] = {0, 1, -1, 9, 10, -10, 99999, 1000000000, INT32_MAX, INT32_MIN, INT32_MIN + 1};
+  for (int32_t v : values) {
+    const Field f[] = {{NUMBER, "n", v, nullptr}};
+    checkEvent("numbers", f, 1);
+  }
+}
+
+// Control characters, quotes, backslashes, DEL and UTF-8 pass through the
+// same escaping in values, keys and the event name
+void test_string_escaping() {
+  char controls[32];
+  for (int i = 1; i < 32; i++) controls[i - 1] = (char)i;
+  controls[31] = '\0';
+  const char* strings[] = {"", controls, "quote \" and backslash \\", "slash / stays", "\x7f", "caf\xc3\xa9 \xe2\x86\x91",
+                           "\\u0041 is not unescaped", "tab\tnewline\n"};
+  for (const char* s : strings) {
+    const Field value[] = {{STRING, "s", 0, s}};
+    checkEvent("strings", value, 1);
+    const Field key[] = {{NUMBER, s, 1, nullptr}};
+    checkEvent("keys", key, 1);
+    checkEvent(s, value, 1);
+  }
+}
+
+// Frames spelled out as cJSON 1.7.18 prints them (print_number's "%d" for
+// integral values, print_string_ptr's lowercase \u00xx escapes, DEL and
+// UTF-8 unescaped), so the format is pinned even without the reference
+void test_known_frames() {
+  char frame[128];
+  EventWriter pos(frame, sizeof(frame), "pos_hit");
+  pos.addNumber("port", 1).addNumber("pos", -7);
+  TEST_ASSERT_TRUE(pos.finish() > 0);
+  TEST_ASSERT_EQUAL_STRING("42[\"pos_hit\",{\"port\":1,\"pos\":-7}]", pos.frame());
+
+  EventWriter status(frame, sizeof(frame), "report_calib_status");
+  status.addNumber("port", 2).addBool("calibrated", false);
+  TEST_ASSERT_TRUE(status.finish() > 0);
+  TEST_ASSERT_EQUAL_STRING("42[\"report_calib_status\",{\"port\":2,\"calibrated\":false}]", status.frame());
+
+  EventWriter edges(frame, sizeof(frame), "n");
+  edges.addNumber("min", INT32_MIN).addNumber("max", INT32_MAX);
+  TEST_ASSERT_TRUE(edges.finish() > 0);
+  TEST_ASSERT_EQUAL_STRING("42[\"n\",{\"min\":-2147483648,\"max\":2147483647}]", edges.frame());
+
+  EventWriter text(frame, sizeof(frame), "s");
+  text.addString("m", "\x01\x1f\b\f\n\r\t\"\\/\x7f\xc3\xa9");
+  TEST_ASSERT_TRUE(text.finish() > 0);
+  TEST_ASSERT_EQUAL_STRING("42[\"s\",{\"m\":\"\\u0001\\u001f\\b\\f\\n\\r\\t\\\"\\\\/\x7f\xc3\xa9\"}]", text.frame());
+}
+
+// A frame that doesn't fit reports 0; one that just fits is complete
+void test_buffer_bounds() {
+  char full[64];
+  EventWriter sized(full, sizeof(full), "pos_hit");
+  sized.addNumber("port", 1).addNumber("pos", 7);
+  size_t len = sized.finish();
+  TEST_ASSERT_TRUE(len > 0);
+
+  for (size_t size = 1; size <= len + 1; size++) {
+    char buf[64];
+    memset(buf, 'x', sizeof(buf));
+    EventWriter w(buf, size, "pos_hit");
+    w.addNumber("port", 1).addNumber("pos", 7);
+    size_t got = w.finish();
+    char msg[32];
+    snprintf(msg, sizeof(msg), "buffer of %zu", size);
+    if (size <= len) TEST_ASSERT_EQUAL_INT_MESSAGE(0, got, msg);
+    else {
+      TEST_ASSERT_EQUAL_INT_MESSAGE(len, got, msg);
+      TEST_ASSERT_EQUAL_STRING_MESSAGE(full, buf, msg);
+    }
+    TEST_ASSERT_TRUE_MESSAGE(buf[size] == 'x', msg); // nothing written past the end
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_firmware_events);
+  RUN_TEST(test_number_edges);
+  RUN_TEST(test_string_escaping);
+  RUN_TEST(test_known_frames);
+  RUN_TEST(test_buffer_bounds);
+  return UNITY_END();
+}
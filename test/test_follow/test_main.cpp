@@ -0,0 +1,111 @@
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "motionChecks.hpp"
+#include "motorModel.hpp"
+#include "profile.hpp"
+#include "defines.h"
+
+// The wand follow law against the simulated motor: a hand turns the wand
+// through a scripted trajectory, and the listener runs on every wand
+// detent and, while the motor is driven, every motor detent, as
+// BlindPort::servoWandListen does. Range bounds and LEDC ramps are left out.
+
+struct HandMove {
+  int32_t ms;
+  float ticksPerS; // wand speed, 0 to hold still
+};
+
+struct FollowRun {
+  FollowStats stats;
+  int32_t finalError; // wand minus motor once everything settled
+};
+
+static FollowRun follow(const HandMove* script, int moves) {
+  MotorModel motor;
+  MotorModel wand;
+  wand.ownsClock = false;
+  wand.deadband = 0;
+  wand.tauS = 0.03f; // a hand gets to speed quickly
+  motor.place(0.5f);
+  wand.place(0.5f);
+
+  PIDGains gains = {defaultKp, defaultKi, defaultKd, defaultKf};
+  WandFollow law;
+  bool driven = false;
+  auto listen = [&]() {
+    int32_t error = wand.count() - motor.count();
+    law.observe(error);
+    int32_t duty = law.duty(error, wand.velocity(), gains.kf, driven);
+    if (duty != 0) law.drive(error, duty, !driven, hostTimeUs, motor.count());
+    motor.duty = duty;
+    driven = duty != 0;
+  };
+
+  for (int m = 0; m <= moves; m++) {
+    // hold still for two seconds after the script so the motor settles
+    int32_t ms = m < moves ? script[m].ms : 2000;
+    wand.duty = m < moves ? (int32_t)(script[m].ticksPerS / wand.gain) : 0;
+    for (int32_t t = 0; t < ms; t++) {
+      int32_t wandCount = wand.count(), motorCount = motor.count();
+      wand.step(1000);
+      motor.step(1000);
+      if (wand.count() != wandCount || (driven && motor.count() != motorCount)) listen();
+    }
+  }
+  return {law.finish(), wand.count() - motor.count()};
+}
+
+static void report(const char* name, const FollowRun& r) {
+  char msg[128];
+  snprintf(msg, sizeof(msg), "%s: max lag %d, overshoot %d, %u starts, final error %d",
+           name, r.stats.maxLag, r.stats.overshoot, r.stats.starts, r.finalError);
+  TEST_MESSAGE(msg);
+}
+
+void setUp() {
+  hostTimeUs = 0;
+}
+void tearDown() {}
+
+// A slow steady turn is tracked closely. The motor runs on inside the
+// deadband instead of stopping each time it catches up (31 starts without).
+void test_slow_turn() {
+  const HandMove script[] = {{500, 0}, {4000, 8}};
+  FollowRun r = follow(script, 2);
+  report("slow turn", r);
+  TEST_ASSERT_LESS_OR_EQUAL(2, r.stats.maxLag);
+  TEST_ASSERT_LESS_OR_EQUAL(1, r.stats.overshoot);
+  TEST_ASSERT_LESS_OR_EQUAL(2, r.stats.starts);
+  TEST_ASSERT_INT_WITHIN(followDeadband, 0, r.finalError);
+}
+
+// Slow, then fast, then back the other way. The fast turn outruns the
+// motor's top speed (about 43 ticks/s here), so the lag grows by roughly
+// 0.6 s * 17 ticks/s plus the spin-up; the motor coasts a few ticks past
+// the wand when the hand stops.
+void test_scripted_trajectory() {
+  const HandMove script[] = {{500, 0}, {3000, 8}, {1000, 0}, {600, 60}, {1500, 0}, {1500, -25}, {500, 0}};
+  FollowRun r = follow(script, 7);
+  report("scripted", r);
+  TEST_ASSERT_LESS_OR_EQUAL(16, r.stats.maxLag);
+  TEST_ASSERT_LESS_OR_EQUAL(3, r.stats.overshoot);
+  TEST_ASSERT_LESS_OR_EQUAL(4, r.stats.starts);
+  TEST_ASSERT_INT_WITHIN(followDeadband, 0, r.finalError);
+}
+
+// A one-detent nudge inside the deadband never starts the motor
+void test_deadband() {
+  const HandMove script[] = {{500, 0}, {100, 10}};
+  FollowRun r = follow(script, 2);
+  TEST_ASSERT_EQUAL_INT32(1, r.finalError);
+  TEST_ASSERT_EQUAL_UINT16(0, r.stats.starts);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_slow_turn);
+  RUN_TEST(test_scripted_trajectory);
+  RUN_TEST(test_deadband);
+  return UNITY_END();
+}
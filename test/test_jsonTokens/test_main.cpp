@@ -0,0 +1,218 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include "jsonTokens.hpp"
+
+// Event arrays as the server sends them, without the "42" packet prefix
+static const char deviceInit[] =
+    "[\"device_init\",{\"type\":\"success\",\"deviceState\":"
+    "[{\"port\":1,\"lastPos\":7},{\"port\":2,\"lastPos\":0},{\"port\":3,\"lastPos\":10}]}]";
+static const char posUpdates[] =
+    "[\"posUpdates\", [ {\"periphNum\": 1, \"pos\": 3},\n"
+    "  {\"periphNum\": 2, \"pos\": 10, \"source\": \"schedule\"},\n"
+    "  {\"periphNum\": 1, \"pos\": -4.9} ] ]";
+
+#define maxTokens 64
+
+static int tokenize(const char* js, JsonToken* tokens, uint16_t max = maxTokens) {
+  return jsonTokenize(js, strlen(js), tokens, max);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_device_init() {
+  JsonToken tokens[maxTokens];
+  int count = tokenize(deviceInit, tokens);
+  TEST_ASSERT_EQUAL_INT(22, count);
+  JsonDoc doc = {deviceInit, tokens, count};
+  TEST_ASSERT_TRUE(doc.isArray(0));
+  TEST_ASSERT_EQUAL_INT(2, doc.size(0));
+  TEST_ASSERT_TRUE(doc.equals(1, "device_init"));
+
+  int data = doc.next(1);
+  TEST_ASSERT_TRUE(doc.isObject(data));
+  TEST_ASSERT_TRUE(doc.equals(doc.get(data, "type"), "success"));
+  int state = doc.get(data, "deviceState");
+  TEST_ASSERT_TRUE(doc.isArray(state));
+  TEST_ASSERT_EQUAL_INT(3, doc.size(state));
+
+  const int32_t ports[] = {1, 2, 3};
+  const int32_t positions[] = {7, 0, 10};
+  for (int i = 0, periph = state + 1; i < 3; i++, periph = doc.next(periph)) {
+    int32_t port = -1, lastPos = -1;
+    TEST_ASSERT_TRUE(doc.getInt(doc.get(periph, "port"), port));
+    TEST_ASSERT_TRUE(doc.getInt(doc.get(periph, "lastPos"), lastPos));
+    TEST_ASSERT_EQUAL_INT32(ports[i], port);
+    TEST_ASSERT_EQUAL_INT32(positions[i], lastPos);
+    TEST_ASSERT_EQUAL_INT(periph, doc.item(state, i));
+  }
+  TEST_ASSERT_EQUAL_INT(count, doc.next(0));
+}
+
+void test_pos_updates_with_whitespace() {
+  JsonToken tokens[maxTokens];
+  int count = tokenize(posUpdates, tokens);
+  TEST_ASSERT_TRUE(count > 0);
+  JsonDoc doc = {posUpdates, tokens, count};
+  int list = doc.next(1);
+  TEST_ASSERT_TRUE(doc.isArray(list));
+  TEST_ASSERT_EQUAL_INT(3, doc.size(list));
+  int32_t value;
+  int second = doc.item(list, 1);
+  TEST_ASSERT_TRUE(doc.getInt(doc.get(second, "pos"), value));
+  TEST_ASSERT_EQUAL_INT32(10, value);
+  TEST_ASSERT_TRUE(doc.equals(doc.get(second, "source"), "schedule"));
+  // fractions truncate
+  TEST_ASSERT_TRUE(doc.getInt(doc.get(doc.item(list, 2), "pos"), value));
+  TEST_ASSERT_EQUAL_INT32(-4, value);
+}
+
+void test_values() {
+  static const char js[] = "{\"s\":\"a\\\"b\\\\\",\"e\":{},\"a\":[],\"t\":true,\"n\":null,"
+                           "\"big\":99999999999,\"small\":-99999999999,\"min\":-2147483648,\"nested\":[[1],[2,[3]]]}";
+  JsonToken tokens[maxTokens];
+  int count = tokenize(js, tokens);
+  TEST_ASSERT_TRUE(count > 0);
+  JsonDoc doc = {js, tokens, count};
+
+  // strings stay escaped
+  int s = doc.get(0, "s");
+  TEST_ASSERT_TRUE(doc.isString(s));
+  TEST_ASSERT_TRUE(doc.equals(s, "a\\\"b\\\\"));
+  TEST_ASSERT_TRUE(doc.isObject(doc.get(0, "e")));
+  TEST_ASSERT_EQUAL_INT(0, doc.size(doc.get(0, "e")));
+  TEST_ASSERT_TRUE(doc.isArray(doc.get(0, "a")));
+  TEST_ASSERT_EQUAL_INT(-1, doc.item(doc.get(0, "a"), 0));
+
+  int32_t value = 0;
+  TEST_ASSERT_FALSE(doc.getInt(doc.get(0, "t"), value));
+  TEST_ASSERT_FALSE(doc.getInt(doc.get(0, "n"), value));
+  TEST_ASSERT_FALSE(doc.getInt(s, value));
+  TEST_ASSERT_TRUE(doc.getInt(doc.get(0, "big"), value));
+  TEST_ASSERT_EQUAL_INT32(INT32_MAX, value);
+  TEST_ASSERT_TRUE(doc.getInt(doc.get(0, "small"), value));
+  TEST_ASSERT_EQUAL_INT32(INT32_MIN, value);
+  TEST_ASSERT_TRUE(doc.getInt(doc.get(0, "min"), value));
+  TEST_ASSERT_EQUAL_INT32(INT32_MIN, value);
+
+  int nested = doc.get(0, "nested");
+  int inner = doc.item(doc.item(nested, 1), 1);
+  TEST_ASSERT_TRUE(doc.getInt(doc.item(inner, 0), value));
+  TEST_ASSERT_EQUAL_INT32(3, value);
+
+  // missing and wrong-type lookups
+  TEST_ASSERT_EQUAL_INT(-1, doc.get(0, "missing"));
+  TEST_ASSERT_EQUAL_INT(-1, doc.get(nested, "s"));
+  TEST_ASSERT_EQUAL_INT(-1, doc.item(nested, 2));
+  TEST_ASSERT_EQUAL_INT(-1, doc.item(nested, -1));
+  TEST_ASSERT_EQUAL_INT(-1, doc.get(-1, "s"));
+  TEST_ASSERT_EQUAL_INT(count, doc.next(count));
+}
+
+void test_malformed() {
+  struct Case {
+    const char* js;
+    int expected;
+  };
+  const Case cases[] = {
+    {"]", JSON_ERROR_INVAL},
+    {"[}", JSON_ERROR_INVAL},
+    {"{]", JSON_ERROR_INVAL},
+    {"{\"a\":1}}", JSON_ERROR_INVAL},
+    {"{1:2}", JSON_ERROR_INVAL},
+    {"{\"a\" 1}", JSON_ERROR_INVAL},
+    {"{[1]:2}", JSON_ERROR_INVAL},
+    {":1", JSON_ERROR_INVAL},
+    {"[1:2]", JSON_ERROR_INVAL},
+    {"[tru{e]", JSON_ERROR_INVAL},
+    {"[1\x01]", JSON_ERROR_INVAL},
+    {"[12\"x\"]", JSON_ERROR_INVAL},
+    {"[", JSON_ERROR_PART},
+    {"[\"abc", JSON_ERROR_PART},
+    {"[\"abc\\\"]", JSON_ERROR_PART}, // escaped quote doesn't close the string
+    {"{\"a\":{}", JSON_ERROR_PART},
+    {"[1,2", JSON_ERROR_PART},
+  };
+  for (const Case& c : cases) {
+    JsonToken tokens[maxTokens];
+    char msg[48];
+    snprintf(msg, sizeof(msg), "%s", c.js);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(c.expected, tokenize(c.js, tokens), msg);
+  }
+}
+
+// Every cut-short frame is an error, and the tokenizer reads nothing past
+// the given length: each prefix sits in a buffer of exactly that size
+void test_truncated_frames() {
+  const char* frames[] = {deviceInit, posUpdates};
+  for (const char* frame : frames) {
+    size_t full = strlen(frame);
+    for (size_t len = 0; len < full; len++) {
+      std::vector<char> prefix(frame, frame + len);
+      JsonToken tokens[maxTokens];
+      int count = jsonTokenize(prefix.data(), len, tokens, maxTokens);
+      char msg[48];
+      snprintf(msg, sizeof(msg), "%.*s", (int)(len < 40 ? len : 40), frame);
+      if (len == 0) TEST_ASSERT_EQUAL_INT_MESSAGE(0, count, msg);
+      else TEST_ASSERT_TRUE_MESSAGE(count < 0, msg);
+    }
+  }
+}
+
+void test_token_limit() {
+  JsonToken tokens[maxTokens];
+  int needed = tokenize(deviceInit, tokens);
+  TEST_ASSERT_EQUAL_INT(needed, tokenize(deviceInit, tokens, needed));
+  TEST_ASSERT_EQUAL_INT(JSON_ERROR_NOMEM, tokenize(deviceInit, tokens, needed - 1));
+  TEST_ASSERT_EQUAL_INT(JSON_ERROR_NOMEM, tokenize(deviceInit, tokens, 0));
+  // offsets are 16 bits
+  std::vector<char> huge(UINT16_MAX, ' ');
+  TEST_ASSERT_EQUAL_INT(JSON_ERROR_INVAL, jsonTokenize(huge.data(), huge.size(), tokens, maxTokens));
+}
+
+// Tokenize and walk each frame the way its handler does
+static int32_t walk(const char* js, size_t len, JsonToken* tokens) {
+  int count = jsonTokenize(js, len, tokens, maxTokens);
+  JsonDoc doc = {js, tokens, count};
+  int list = doc.next(1);
+  if (doc.isObject(list)) list = doc.get(list, "deviceState");
+  int32_t sum = 0, value;
+  for (int i = 0, item = list + 1; i < doc.size(list); i++, item = doc.next(item)) {
+    if (doc.getInt(doc.get(item, "port"), value) || doc.getInt(doc.get(item, "periphNum"), value)) sum += value;
+    if (doc.getInt(doc.get(item, "lastPos"), value) || doc.getInt(doc.get(item, "pos"), value)) sum += value;
+  }
+  return sum;
+}
+
+void test_benchmark() {
+  const char* frames[] = {deviceInit, posUpdates};
+  const char* names[] = {"device_init", "posUpdates"};
+  const int rounds = 200000;
+  for (int f = 0; f < 2; f++) {
+    JsonToken tokens[maxTokens];
+    size_t len = strlen(frames[f]);
+    volatile int32_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) sink = sink + walk(frames[f], len, tokens);
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / rounds;
+    char msg[96];
+    snprintf(msg, sizeof(msg), "%s (%zu bytes, %d tokens): %.0f ns per frame on this host",
+             names[f], len, jsonTokenize(frames[f], len, tokens, maxTokens), ns);
+    TEST_MESSAGE(msg);
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_device_init);
+  RUN_TEST(test_pos_updates_with_whitespace);
+  RUN_TEST(test_values);
+  RUN_TEST(test_malformed);
+  RUN_TEST(test_truncated_frames);
+  RUN_TEST(test_token_limit);
+  RUN_TEST(test_benchmark);
+  return UNITY_END();
+}
@@ -0,0 +1,119 @@
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "profile.hpp"
+#include "motorModel.hpp"
+#include "defines.h"
+
+static const PIDGains gains = {defaultKp, defaultKi, defaultKd, defaultKf};
+
+// The profile alone runs a few ticks past and pulls back; on the device the
+// learned coast cut in BlindPort stops it earlier. This bounds regressions.
+#define maxOvershoot 4
+
+struct MoveResult {
+  int32_t settleMs;  // until the profile reports the move settled, -1 if it never did
+  int32_t overshoot; // furthest past the target, ticks
+  int32_t finalError;
+};
+
+// Run one server move the way the motion task does: a profile update every
+// control period, duty held in between, and power off once it settles.
+static MoveResult simulateMove(MotorModel& motor, int32_t target, int32_t retargetAtMs = -1, int32_t retarget = 0) {
+  MotionProfile profile;
+  hostTimeUs = 0;
+  motor.duty = 0;
+  profile.start(target);
+  bool up = target > motor.count();
+  MoveResult result = {-1, 0, 0};
+  for (int32_t ms = 0; ms < 20000; ms++) {
+    if (ms == retargetAtMs) {
+      target = retarget;
+      up = target > motor.count();
+      result.overshoot = 0;
+      profile.start(target);
+    }
+    if (ms % controlPeriodMs == 0 && result.settleMs < 0) {
+      int32_t duty;
+      if (profile.update(motor.count(), motor.velocity() / 1000.0f, controlPeriodMs / 1000.0f, gains, duty))
+        motor.duty = duty;
+      else {
+        motor.duty = 0;
+        result.settleMs = ms;
+      }
+    }
+    motor.step(1000);
+    int32_t past = up ? motor.count() - target : target - motor.count();
+    if (past > result.overshoot) result.overshoot = past;
+    if (result.settleMs >= 0 && ms > result.settleMs + 500) break;
+  }
+  result.finalError = motor.count() - target;
+  return result;
+}
+
+// Trapezoid time for the distance at profileMaxVel and profileAccel
+static int32_t idealMs(int32_t distance) {
+  float d = abs(distance);
+  float rampD = profileMaxVel * profileMaxVel / profileAccel;
+  float s = d < rampD ? 2 * sqrtf(d / profileAccel) : d / profileMaxVel + profileMaxVel / profileAccel;
+  return (int32_t)(s * 1000);
+}
+
+static void checkMove(float plantGain, int32_t from, int32_t to) {
+  MotorModel motor;
+  motor.gain = plantGain;
+  motor.place(from + 0.5f);
+  MoveResult r = simulateMove(motor, to);
+  char msg[128];
+  snprintf(msg, sizeof(msg), "%d -> %d, plant %.0f%%: settled %d ms (ideal %d), overshoot %d, final error %d",
+           from, to, plantGain * defaultKf * 100, r.settleMs, idealMs(to - from), r.overshoot, r.finalError);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_TRUE_MESSAGE(r.settleMs >= 0, msg);
+  TEST_ASSERT_LESS_OR_EQUAL_MESSAGE(idealMs(to - from) + 1500, r.settleMs, msg);
+  TEST_ASSERT_LESS_OR_EQUAL_MESSAGE(maxOvershoot, r.overshoot, msg);
+  TEST_ASSERT_LESS_OR_EQUAL_MESSAGE(profileTolerance + 1, abs(r.finalError), msg);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_moves_nominal_plant() {
+  const int32_t distances[] = {3, 10, 40, 150, 400};
+  for (int32_t d : distances) {
+    checkMove(1.0f / defaultKf, 0, d);
+    checkMove(1.0f / defaultKf, 0, -d);
+  }
+}
+
+// Feed-forward off by 25% either way; the PID has to make up the difference
+void test_moves_mismatched_plant() {
+  const int32_t distances[] = {10, 150};
+  for (int32_t d : distances) {
+    checkMove(0.75f / defaultKf, 0, d);
+    checkMove(1.25f / defaultKf, 0, d);
+    checkMove(1.25f / defaultKf, 0, -d);
+  }
+}
+
+// Retarget behind the motor mid-cruise: it brakes, reverses and settles
+void test_retarget_reverses() {
+  MotorModel motor;
+  motor.gain = 1.0f / defaultKf;
+  motor.place(0.5f);
+  MoveResult r = simulateMove(motor, 300, 2000, 20);
+  char msg[96];
+  snprintf(msg, sizeof(msg), "0 -> 300, retargeted to 20 at 2 s: settled %d ms, overshoot %d, final error %d",
+           r.settleMs, r.overshoot, r.finalError);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_TRUE_MESSAGE(r.settleMs >= 0, msg);
+  TEST_ASSERT_LESS_OR_EQUAL_MESSAGE(maxOvershoot, r.overshoot, msg);
+  TEST_ASSERT_LESS_OR_EQUAL_MESSAGE(profileTolerance + 1, abs(r.finalError), msg);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_moves_nominal_plant);
+  RUN_TEST(test_moves_mismatched_plant);
+  RUN_TEST(test_retarget_reverses);
+  return UNITY_END();
+}
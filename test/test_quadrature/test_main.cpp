@@ -0,0 +1,117 @@
+#include <unity.h>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include "quadrature.hpp"
+
+// Position of each AB state along the forward (count up) Gray sequence 00 -> 10 -> 11 -> 01
+static int grayPos(uint8_t ab) {
+  static const int pos[4] = {0, 3, 1, 2};
+  return pos[ab];
+}
+
+// Decoder that quadTable replaced: nested branches on whichever pin changed.
+// A double transition is taken as a step in whatever direction pin A implies.
+static int legacyStep(uint8_t prev, uint8_t cur) {
+  uint8_t lastA = prev >> 1, lastB = prev & 1;
+  uint8_t a = cur >> 1, b = cur & 1;
+  if (a != lastA) {
+    if (!a) return b ? 1 : -1;
+    return b ? -1 : 1;
+  }
+  if (b != lastB) {
+    if (!b) return a ? -1 : 1;
+    return a ? 1 : -1;
+  }
+  return 0;
+}
+
+void setUp() {}
+void tearDown() {}
+
+// Every one of the 16 transitions against the Gray code distance
+void test_table_matches_gray_code() {
+  for (uint8_t prev = 0; prev < 4; prev++) {
+    for (uint8_t cur = 0; cur < 4; cur++) {
+      int delta = (grayPos(cur) - grayPos(prev) + 4) % 4;
+      int expected = delta == 0 ? 0 : (delta == 1 ? 1 : (delta == 3 ? -1 : QUAD_ERR));
+      char msg[32];
+      snprintf(msg, sizeof(msg), "prev %u cur %u", prev, cur);
+      TEST_ASSERT_EQUAL_INT_MESSAGE(expected, quadTable[(prev << 2) | cur], msg);
+    }
+  }
+}
+
+// Single steps decode exactly as before; only double transitions differ
+void test_table_matches_legacy_single_steps() {
+  for (uint8_t prev = 0; prev < 4; prev++) {
+    for (uint8_t cur = 0; cur < 4; cur++) {
+      int8_t quarter = quadTable[(prev << 2) | cur];
+      if (quarter == QUAD_ERR) continue;
+      TEST_ASSERT_EQUAL_INT(legacyStep(prev, cur), quarter);
+    }
+  }
+}
+
+// A random walk of legal quarter steps decodes back to its net displacement
+void test_random_walk_round_trip() {
+  srand(1);
+  uint8_t state = 0;
+  int32_t pos = 0, decoded = 0;
+  for (int i = 0; i < 100000; i++) {
+    int dir = (rand() % 3) - 1;
+    int next = (grayPos(state) + dir + 4) % 4;
+    static const uint8_t stateAt[4] = {0, 2, 3, 1};
+    uint8_t cur = stateAt[next];
+    decoded += quadTable[(state << 2) | cur];
+    pos += dir;
+    state = cur;
+  }
+  TEST_ASSERT_EQUAL_INT32(pos, decoded);
+}
+
+// Old branches vs table over the same recorded edge stream. Host timing, so
+// only the ratio says anything about the ISR.
+void test_benchmark_legacy_vs_table() {
+  const int N = 1 << 20;
+  static uint8_t trace[1 << 20];
+  static const uint8_t stateAt[4] = {0, 2, 3, 1};
+  srand(2);
+  int gray = 0;
+  trace[0] = 0;
+  for (int i = 1; i < N; i++) {
+    gray = (gray + (rand() % 2 ? 1 : 3)) % 4;
+    trace[i] = stateAt[gray];
+  }
+
+  volatile int32_t sink;
+  auto t0 = std::chrono::steady_clock::now();
+  int32_t legacy = 0;
+  for (int i = 1; i < N; i++) legacy += legacyStep(trace[i - 1], trace[i]);
+  sink = legacy;
+  auto t1 = std::chrono::steady_clock::now();
+  int32_t table = 0;
+  for (int i = 1; i < N; i++) {
+    int8_t quarter = quadTable[(trace[i - 1] << 2) | trace[i]];
+    if (quarter != QUAD_ERR) table += quarter;
+  }
+  sink = table;
+  auto t2 = std::chrono::steady_clock::now();
+  (void)sink;
+
+  char msg[96];
+  snprintf(msg, sizeof(msg), "legacy %.2f ns/edge, table %.2f ns/edge",
+           std::chrono::duration<double, std::nano>(t1 - t0).count() / (N - 1),
+           std::chrono::duration<double, std::nano>(t2 - t1).count() / (N - 1));
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_EQUAL_INT32(legacy, table);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_table_matches_gray_code);
+  RUN_TEST(test_table_matches_legacy_single_steps);
+  RUN_TEST(test_random_walk_round_trip);
+  RUN_TEST(test_benchmark_legacy_vs_table);
+  return UNITY_END();
+}
@@ -0,0 +1,98 @@
+#include <unity.h>
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "motion.hpp"
+
+// One writer publishes records whose fields are all derived from a
+// sequence number; readers on other threads must only ever see whole
+// records, in order. The payload is the size of MotionState so the copy
+// spans several words.
+struct Record {
+  uint32_t n;
+  int32_t fields[7];
+  uint32_t check; // n ^ every field
+};
+
+static Record makeRecord(uint32_t n) {
+  Record r;
+  r.n = n;
+  r.check = n;
+  for (int i = 0; i < 7; i++) {
+    r.fields[i] = (int32_t)(n * 2654435761u + i);
+    r.check ^= (uint32_t)r.fields[i];
+  }
+  return r;
+}
+
+static bool whole(const Record& r) {
+  uint32_t check = r.n;
+  for (int i = 0; i < 7; i++) {
+    if (r.fields[i] != (int32_t)(r.n * 2654435761u + i)) return false;
+    check ^= (uint32_t)r.fields[i];
+  }
+  return check == r.check;
+}
+
+#define writes 2000000
+#define readers 3
+
+void setUp() {}
+void tearDown() {}
+
+void test_readers_never_see_torn_records() {
+  static Seqlock<Record> lock;
+  lock.write(makeRecord(0));
+  std::atomic<bool> done{false};
+  std::atomic<uint32_t> torn{0};
+  std::atomic<uint32_t> backwards{0};
+  std::atomic<uint64_t> reads{0};
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < readers; t++) {
+    threads.emplace_back([&] {
+      uint32_t last = 0;
+      uint64_t count = 0;
+      while (!done.load(std::memory_order_relaxed)) {
+        Record r = lock.read();
+        if (!whole(r)) torn++;
+        if (r.n < last) backwards++;
+        last = r.n;
+        count++;
+      }
+      reads += count;
+    });
+  }
+  for (uint32_t n = 1; n <= writes; n++) lock.write(makeRecord(n));
+  done = true;
+  for (std::thread& t : threads) t.join();
+
+  char msg[96];
+  snprintf(msg, sizeof(msg), "%u writes, %llu reads on %d threads", writes, (unsigned long long)reads.load(), readers);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_EQUAL_INT32(0, torn.load());
+  TEST_ASSERT_EQUAL_INT32(0, backwards.load());
+  TEST_ASSERT_TRUE(whole(lock.read()) && lock.read().n == writes);
+}
+
+// A payload that isn't a whole number of words keeps its tail bytes
+void test_odd_size_payload() {
+  struct Odd {
+    int32_t a;
+    uint8_t b[3];
+  };
+  Seqlock<Odd> lock;
+  Odd in = {-12345, {1, 2, 3}};
+  lock.write(in);
+  Odd out = lock.read();
+  TEST_ASSERT_EQUAL_INT32(in.a, out.a);
+  TEST_ASSERT_EQUAL_MEMORY(in.b, out.b, sizeof(in.b));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_readers_never_see_torn_records);
+  RUN_TEST(test_odd_size_payload);
+  return UNITY_END();
+}
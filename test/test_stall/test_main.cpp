@@ -0,0 +1,105 @@
+#include <unity.h>
+#include <stdio.h>
+#include "motionChecks.hpp"
+#include "motorModel.hpp"
+#include "defines.h"
+
+// Drive the simulated motor the way BlindPort does: start the monitor when
+// the motor is first driven, check it every control period with the latest
+// detent interval. Returns when the monitor trips or after runMs.
+struct StallRun {
+  int32_t tripMs; // -1 if it never tripped
+  uint32_t sinceUs;
+};
+
+static StallRun runMotor(MotorModel& motor, int32_t duty, int32_t runMs, int32_t jamAtMs = -1) {
+  StallMonitor stall;
+  int64_t startUs = hostTimeUs;
+  motor.duty = duty;
+  stall.start(hostTimeUs, motor.lastEdgeUs);
+  for (int32_t ms = 0; ms < runMs; ms++) {
+    if (ms == jamAtMs) motor.jammed = true;
+    motor.step(1000);
+    if (ms % controlPeriodMs == 0) {
+      uint32_t since;
+      if (stall.stalled(hostTimeUs, motor.lastEdgeUs, motor.edgePeriodUs, 0, since))
+        return {(int32_t)((hostTimeUs - startUs) / 1000), since};
+    }
+  }
+  return {-1, 0};
+}
+
+void setUp() {
+  hostTimeUs = 0;
+}
+void tearDown() {}
+
+// Regression: a run starting long after the last detent must get the
+// spin-up allowance, not be measured from that old detent
+void test_no_trip_starting_after_long_idle() {
+  MotorModel motor;
+  motor.place(100.5f);
+  motor.duty = 800;
+  for (int i = 0; i < 300; i++) motor.step(1000); // an earlier run, leaving a detent behind
+  motor.duty = 0;
+  for (int i = 0; i < 600; i++) motor.step(100000); // a minute idle
+  StallRun r = runMotor(motor, 800, 3000);
+  TEST_ASSERT_EQUAL_INT32(-1, r.tripMs);
+}
+
+// First boot: no detent has ever been seen
+void test_no_trip_on_first_run_after_boot() {
+  MotorModel motor;
+  hostTimeUs = 5000000;
+  StallRun r = runMotor(motor, 800, 3000);
+  TEST_ASSERT_EQUAL_INT32(-1, r.tripMs);
+}
+
+// Speeds that still make progress, down to the least drive the wand follow uses
+void test_no_trip_at_slow_speed() {
+  const int32_t duties[] = {followMinDuty, 300, 1600, -followMinDuty};
+  for (int32_t duty : duties) {
+    MotorModel motor;
+    StallRun r = runMotor(motor, duty, 4000);
+    char msg[48];
+    snprintf(msg, sizeof(msg), "duty %d", duty);
+    TEST_ASSERT_EQUAL_INT32_MESSAGE(-1, r.tripMs, msg);
+  }
+}
+
+// A motor that never turns is caught once the spin-up allowance runs out
+void test_trip_when_motor_never_moves() {
+  MotorModel motor;
+  motor.jammed = true;
+  StallRun r = runMotor(motor, 800, 3000);
+  char msg[64];
+  snprintf(msg, sizeof(msg), "tripped after %d ms", r.tripMs);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_INT_WITHIN(controlPeriodMs, stallMaxMs, r.tripMs);
+}
+
+// Jam mid-run at several speeds: latency from jam to trip
+void test_jam_latency() {
+  const int32_t duties[] = {300, 800, 1600};
+  for (int32_t duty : duties) {
+    MotorModel motor;
+    StallRun r = runMotor(motor, duty, 5000, 2000);
+    int32_t latency = r.tripMs - 2000;
+    char msg[96];
+    snprintf(msg, sizeof(msg), "duty %d (%.0f ticks/s): stall caught %d ms after the jam",
+             duty, (duty - motor.deadband) * motor.gain, latency);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_TRUE_MESSAGE(r.tripMs >= 0, msg);
+    TEST_ASSERT_LESS_OR_EQUAL_MESSAGE(stallMaxMs + controlPeriodMs, latency, msg);
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_no_trip_starting_after_long_idle);
+  RUN_TEST(test_no_trip_on_first_run_after_boot);
+  RUN_TEST(test_no_trip_at_slow_speed);
+  RUN_TEST(test_trip_when_motor_never_moves);
+  RUN_TEST(test_jam_latency);
+  return UNITY_END();
+}
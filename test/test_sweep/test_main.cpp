@@ -0,0 +1,147 @@
+#include <unity.h>
+#include <stdio.h>
+#include "motionChecks.hpp"
+#include "motorModel.hpp"
+#include "defines.h"
+
+// Drive the simulated motor into an end stop the way the calibration sweep
+// does: autoCalibDuty toward the stop, the seeker updated every control period
+// with the measured speed. Returns when the seeker decides, with the count.
+struct SweepRun {
+  SeekResult result;
+  int32_t ms;
+  int32_t count;
+  float peak;
+};
+
+static SweepRun seekEndStop(MotorModel& motor, int8_t dir) {
+  EndStopSeeker seek;
+  int64_t startUs = hostTimeUs;
+  motor.duty = dir * autoCalibDuty;
+  seek.start(hostTimeUs);
+  for (;;) {
+    for (int i = 0; i < controlPeriodMs; i++) motor.step(1000);
+    float speed = fabsf(motor.velocity() / 1000.0f);
+    SeekResult r = seek.update(hostTimeUs, speed);
+    if (r != SEEK_RUNNING) {
+      motor.duty = 0;
+      return {r, (int32_t)((hostTimeUs - startUs) / 1000), motor.count(), seek.getPeak()};
+    }
+  }
+}
+
+static const char* resultName(SeekResult r) {
+  switch (r) {
+    case SEEK_RUNNING: return "running";
+    case SEEK_FOUND: return "found";
+    case SEEK_NO_MOTION: return "no motion";
+    case SEEK_TIMEOUT: return "timeout";
+  }
+  return "?";
+}
+
+void setUp() {
+  hostTimeUs = 0;
+}
+void tearDown() {}
+
+// A normal sweep in each direction finds the stop it ran into
+void test_finds_both_end_stops() {
+  MotorModel motor;
+  motor.lowStop = 0;
+  motor.highStop = 300;
+  motor.place(150.5f);
+  const int8_t dirs[] = {-1, 1};
+  for (int8_t dir : dirs) {
+    SweepRun r = seekEndStop(motor, dir);
+    int32_t stop = dir < 0 ? 0 : 300;
+    char msg[96];
+    snprintf(msg, sizeof(msg), "dir %d: %s at %d after %d ms (peak %.1f ticks/s)",
+             dir, resultName(r.result), r.count, r.ms, r.peak);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(SEEK_FOUND, r.result, msg);
+    TEST_ASSERT_INT_WITHIN_MESSAGE(1, stop, r.count, msg);
+  }
+}
+
+// A slower servo than the nominal one still reads as moving
+void test_finds_end_stop_with_weak_motor() {
+  MotorModel motor;
+  motor.gain *= 0.5f;
+  motor.lowStop = 0;
+  motor.place(60.5f);
+  SweepRun r = seekEndStop(motor, -1);
+  char msg[96];
+  snprintf(msg, sizeof(msg), "%s at %d after %d ms (peak %.1f ticks/s)", resultName(r.result), r.count, r.ms, r.peak);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_EQUAL_INT_MESSAGE(SEEK_FOUND, r.result, msg);
+  TEST_ASSERT_INT_WITHIN_MESSAGE(1, 0, r.count, msg);
+}
+
+// Regression: a motor that never turns used to pass the collapse test
+// (0 >= 0) until the sweep timed out
+void test_no_motion_after_spin_up() {
+  MotorModel motor;
+  motor.jammed = true;
+  SweepRun r = seekEndStop(motor, 1);
+  TEST_ASSERT_EQUAL_INT(SEEK_NO_MOTION, r.result);
+  TEST_ASSERT_INT_WITHIN(controlPeriodMs, autoCalibSpinUpMs, r.ms);
+}
+
+// Already resting against the stop being sought: the motor can't move either
+void test_no_motion_when_started_at_end_stop() {
+  MotorModel motor;
+  motor.highStop = 100;
+  motor.place(100);
+  SweepRun r = seekEndStop(motor, 1);
+  TEST_ASSERT_EQUAL_INT(SEEK_NO_MOTION, r.result);
+}
+
+// No end stop within reach
+void test_timeout_without_end_stop() {
+  MotorModel motor;
+  SweepRun r = seekEndStop(motor, 1);
+  TEST_ASSERT_EQUAL_INT(SEEK_TIMEOUT, r.result);
+  TEST_ASSERT_INT_WITHIN(controlPeriodMs, autoCalibTimeoutMs, r.ms);
+}
+
+// Both sweeps of a full calibration give the duty per tick/s the model
+// needs at the sweep's speed; a weaker servo needs proportionally more
+void test_feed_forward_from_sweeps() {
+  const float gains[] = {1.0f, 0.5f};
+  for (float g : gains) {
+    MotorModel motor;
+    motor.gain *= g;
+    motor.lowStop = 0;
+    motor.highStop = 300;
+    motor.place(150.5f);
+    SweepRun up = seekEndStop(motor, 1);
+    SweepRun down = seekEndStop(motor, -1);
+    float kf = sweepFeedForward(up.peak, down.peak);
+    float steady = (autoCalibDuty - motor.deadband) * motor.gain; // ticks/s at autoCalibDuty
+    char msg[80];
+    snprintf(msg, sizeof(msg), "gain x%.1f: kf %.1f, peaks %.1f / %.1f ticks/s", g, kf, up.peak, down.peak);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_FLOAT_WITHIN_MESSAGE(autoCalibDuty / steady * 0.05f, autoCalibDuty / steady, kf, msg);
+  }
+}
+
+// Speeds that no servo on this board produces leave the gains alone
+void test_feed_forward_rejects_implausible_sweeps() {
+  TEST_ASSERT_EQUAL_FLOAT(0, sweepFeedForward(0, 14));
+  TEST_ASSERT_EQUAL_FLOAT(0, sweepFeedForward(1, 1));
+  float fast = autoCalibDuty / (defaultKf / kfTuneRange) * 2; // twice what the fastest plausible servo reaches
+  TEST_ASSERT_EQUAL_FLOAT(0, sweepFeedForward(fast, fast));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_finds_both_end_stops);
+  RUN_TEST(test_finds_end_stop_with_weak_motor);
+  RUN_TEST(test_no_motion_after_spin_up);
+  RUN_TEST(test_no_motion_when_started_at_end_stop);
+  RUN_TEST(test_timeout_without_end_stop);
+  RUN_TEST(test_feed_forward_from_sweeps);
+  RUN_TEST(test_feed_forward_rejects_implausible_sweeps);
+  return UNITY_END();
+}